@@ -0,0 +1,121 @@
+/**
+ * @file	BundleAllocations.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Counts the allocations made while a bundle is built. All the memory is
+ * taken through a counting OSCAllocator, so the numbers do not depend on
+ * the MemoryManager. The element array of the bundle grows geometrically, so
+ * adding 500 messages may take only a few reallocations. Adopting a message
+ * hands it over without a copy, so it should not allocate at all.
+ *
+ * Build and run:
+ *
+ * 	gcc -std=gnu99 -DOSC_STATIC_ALLOCATION -DOSC_STATIC_MEMORY_SIZE=1048576 -Iinc src/OSC/OSC*.c examples/BundleAllocations.c -o BundleAllocations
+ * 	./BundleAllocations
+ *
+ */
+
+#include <stdio.h>
+
+#include "OSC/OSC.h"
+
+#define MESSAGE_COUNT	500
+#define MAX_GROWTHS		8		/* the first array and its doublings from 8 to 512, plus one spare */
+
+typedef struct {
+	uint32_t mallocs;
+	uint32_t reallocs;
+} AllocationCount;
+
+static void* countingAllocate(void *context, uint32_t size) {
+	((AllocationCount*)context)->mallocs++;
+	return OSCAllocator_malloc(&OSCAllocator_default, size);
+}
+
+static void* countingReallocate(void *context, void *ptr, uint32_t size) {
+	((AllocationCount*)context)->reallocs++;
+	return OSCAllocator_realloc(&OSCAllocator_default, ptr, size);
+}
+
+static void countingRelease(void *context, void *ptr) {
+	(void)context;
+	OSCAllocator_free(&OSCAllocator_default, ptr);
+}
+
+int main(void) {
+	AllocationCount count = { 0, 0 };
+	OSCAllocator allocator = { countingAllocate, countingReallocate, countingRelease, &count };
+	int failed = 0;
+	uint32_t i;
+
+	OSCMessage *msg = OSCMessage_newWithAllocator(&allocator);
+	OSCMessage_setAddress(msg, "/mixer/fader");
+	OSCMessage_addArgument_int32(msg, 1);
+
+	/*
+	 * Adding copies of a message
+	 */
+	OSCBundle *bundle = OSCBundle_newWithAllocator(&allocator);
+	count.mallocs = count.reallocs = 0;
+
+	for (i = 0; i < MESSAGE_COUNT; i++)
+		failed |= (OSCBundle_addMessage(bundle, msg) != OSC_OK);
+
+	printf("addMessage x%d: %u allocations, %u reallocations\n", MESSAGE_COUNT, count.mallocs, count.reallocs);
+	failed |= (count.reallocs > MAX_GROWTHS);
+
+	OSCBundle_delete(bundle);
+
+	/*
+	 * Adopting messages built beforehand
+	 */
+	OSCMessage *msgs[MESSAGE_COUNT];
+	for (i = 0; i < MESSAGE_COUNT; i++)
+		msgs[i] = OSCMessage_clone(msg);
+
+	bundle = OSCBundle_newWithAllocator(&allocator);
+	count.mallocs = count.reallocs = 0;
+
+	for (i = 0; i < MESSAGE_COUNT; i++) {
+		if (msgs[i] == NULL) {
+			failed = 1;
+		} else if (OSCBundle_adoptMessage(bundle, msgs[i]) != OSC_OK) {
+			OSCMessage_delete(msgs[i]);
+			failed = 1;
+		}
+	}
+
+	printf("adoptMessage x%d: %u allocations, %u reallocations\n", MESSAGE_COUNT, count.mallocs, count.reallocs);
+	failed |= (count.mallocs != 0 || count.reallocs > MAX_GROWTHS);
+
+	OSCBundle_delete(bundle);
+	OSCMessage_delete(msg);
+
+	return failed;
+}
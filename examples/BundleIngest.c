@@ -0,0 +1,179 @@
+/**
+ * @file	BundleIngest.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Measures how the time OSCServer_handlePacket takes on a bundle grows with
+ * the number of its messages. Bundles of 50 to 800 messages are handled
+ * many times and the time per message is printed, once for an immediate
+ * bundle (the messages are dispatched) and once for a bundle with a future
+ * timetag (the messages are stored until it). The time per message should
+ * stay about the same for every bundle size. The static profile limits the
+ * stored messages, so the limit is lifted in the build line.
+ *
+ * Build and run (Linux):
+ *
+ * 	gcc -std=gnu99 -O2 -DOSC_STATIC_ALLOCATION -DOSC_STATIC_MEMORY_SIZE=1048576 -DOSC_MAX_QUEUED_MESSAGES=0 -Iinc src/OSC/OSC*.c examples/BundleIngest.c -o BundleIngest
+ * 	./BundleIngest
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "OSC/OSC.h"
+
+#define MAX_MESSAGES	800
+#define PACKET_SIZE		(MAX_MESSAGES * 40)
+#define HANDLED_MESSAGES	400000	/* Messages handled for every bundle size */
+#define CHANNEL_COUNT	16
+
+static const uint32_t bundleSizes[] = { 50, 100, 200, 400, 800 };
+
+static uint64_t now = 1000ULL << 32;
+static uint32_t handled;
+
+static uint64_t getTime(void) {
+	return now;
+}
+
+static void handler(OSCMessage *msg) {
+	(void)msg;
+	handled++;
+}
+
+static uint64_t getNanoseconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Encodes a bundle of count messages to the channels in turns
+ */
+static OSCResult buildBundle(uint32_t count, uint64_t timetag, uint8_t *packet, uint32_t *size) {
+	OSCBundle *bundle = OSCBundle_new();
+	OSCMessage *msg = OSCMessage_new();
+	OSCResult res = OSC_ALLOC_FAILED;
+	char address[32];
+	uint32_t i;
+
+	if (bundle != NULL && msg != NULL) {
+		OSCBundle_setTimetag(bundle, timetag);
+		OSCMessage_addArgument_float(msg, 0.5f);
+
+		for (i=0, res=OSC_OK; i<count && res == OSC_OK; i++) {
+			snprintf(address, sizeof(address), "/mixer/%u/fader", i % CHANNEL_COUNT);
+			res = OSCMessage_setAddress(msg, address);
+
+			if (res == OSC_OK)
+				res = OSCBundle_addMessage(bundle, msg);
+		}
+
+		if (res == OSC_OK)
+			res = OSCBundle_encode(bundle, packet, PACKET_SIZE, size);
+	}
+
+	if (msg != NULL)
+		OSCMessage_delete(msg);
+	if (bundle != NULL)
+		OSCBundle_delete(bundle);
+
+	return res;
+}
+
+/*
+ * Returns the time per message of handling the bundle, a stored bundle is handled by a cycle
+ * after the clock has passed its timetag (which is not measured)
+ */
+static double measure(OSCServer *server, uint8_t *packet, uint32_t size, uint32_t count, uint8_t stored) {
+	uint32_t rounds = HANDLED_MESSAGES / count;
+	uint64_t elapsed = 0;
+	uint32_t i;
+
+	for (i=0; i<rounds; i++) {
+		uint64_t start = getNanoseconds();
+		OSCServer_handlePacket(server, packet, size);
+		elapsed += getNanoseconds() - start;
+
+		if (stored) {
+			now += 2ULL << 32;
+			OSCServer_cycle(server, NULL);
+			now -= 2ULL << 32;
+		}
+	}
+
+	return (double)elapsed / (rounds * count);
+}
+
+int main(void) {
+	static uint8_t immediate[PACKET_SIZE], future[PACKET_SIZE];
+	uint32_t immediateSize, futureSize;
+	char address[32];
+	int failed = 0;
+	uint32_t i;
+
+	OSCServer *server = OSCServer_new(getTime);
+
+	if (server == NULL) {
+		printf("cannot create the server\n");
+		return 1;
+	}
+
+	for (i=0; i<CHANNEL_COUNT; i++) {
+		snprintf(address, sizeof(address), "/mixer/%u/fader", i);
+		OSCServer_addMessageHandler(server, address, handler);
+	}
+
+	printf("messages  immediate ns/message  stored ns/message\n");
+
+	for (i=0; i<sizeof(bundleSizes)/sizeof(bundleSizes[0]); i++) {
+		uint32_t count = bundleSizes[i];
+
+		if (buildBundle(count, OSCTimetag_immediately, immediate, &immediateSize) != OSC_OK ||
+				buildBundle(count, now + (1ULL << 32), future, &futureSize) != OSC_OK) {
+			printf("cannot build a bundle of %u messages\n", count);
+			failed = 1;
+			break;
+		}
+
+		measure(server, immediate, immediateSize, count, 0);	// warm-up, the server buffers grow
+		measure(server, future, futureSize, count, 1);
+
+		handled = 0;
+		double immediateTime = measure(server, immediate, immediateSize, count, 0);
+		double storedTime = measure(server, future, futureSize, count, 1);
+
+		printf("%8u  %20.1f  %17.1f\n", count, immediateTime, storedTime);
+		failed |= (handled != 2 * (HANDLED_MESSAGES / count) * count);
+	}
+
+	OSCServer_delete(server);
+
+	return failed;
+}
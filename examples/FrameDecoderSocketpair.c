@@ -0,0 +1,200 @@
+/**
+ * @file	FrameDecoderSocketpair.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Checks OSCFrameDecoder over a real byte stream. Messages with blobs of
+ * every size from 0 to 199 bytes (so the frames contain escaped bytes) are
+ * framed with SLIP and with size prefixes, written into a socketpair in
+ * chunks of random size and decoded from reads of random size. Every message
+ * must arrive once, in order and intact. The same data is then decoded from
+ * one chunk (the in-place path).
+ *
+ * Build and run (Linux):
+ *
+ * 	gcc -std=gnu99 -DOSC_STATIC_ALLOCATION -DOSC_STATIC_MEMORY_SIZE=1048576 -Iinc src/OSC/OSC*.c examples/FrameDecoderSocketpair.c -o FrameDecoderSocketpair
+ * 	./FrameDecoderSocketpair
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "OSC/OSC.h"
+
+#define MESSAGE_COUNT	300
+#define STREAM_SIZE		(1 << 20)
+
+static uint8_t stream[STREAM_SIZE];	/* Framed packets */
+static uint32_t streamSize;
+
+static uint32_t received, errors;
+
+static uint64_t getTime(void) {
+	return OSCTimetag_immediately;
+}
+
+static uint8_t blobByte(int32_t value, uint32_t position) {
+	return (uint8_t)(value*7 + position);	// covers the SLIP END and ESC bytes
+}
+
+/*
+ * Checks that the messages arrive in order and intact
+ */
+static void handleMessage(OSCMessage *oscMessage) {
+	uint32_t size, i;
+	int32_t value = OSCMessage_getArgument_int32(oscMessage, 0);
+	const uint8_t *blob = OSCMessage_getArgument_blob(oscMessage, 1, &size);
+
+	if (value != (int32_t)received % MESSAGE_COUNT || size != (uint32_t)value % 200)
+		errors++;
+
+	for (i = 0; i < size; i++) {
+		if (blob[i] != blobByte(value, i))
+			errors++;
+	}
+
+	received++;
+}
+
+/*
+ * Frames the packet into the stream buffer
+ */
+static void writeFrame(void *context, uint8_t *buf, uint32_t size) {
+	OSCFraming framing = *(OSCFraming*)context;
+	uint32_t i;
+
+	if (framing == OSC_FRAMING_SLIP) {
+		stream[streamSize++] = 0xC0;
+		for (i = 0; i < size; i++) {
+			if (buf[i] == 0xC0) {
+				stream[streamSize++] = 0xDB;
+				stream[streamSize++] = 0xDC;
+			} else if (buf[i] == 0xDB) {
+				stream[streamSize++] = 0xDB;
+				stream[streamSize++] = 0xDD;
+			} else {
+				stream[streamSize++] = buf[i];
+			}
+		}
+		stream[streamSize++] = 0xC0;
+	} else {
+		stream[streamSize++] = size >> 24;
+		stream[streamSize++] = size >> 16;
+		stream[streamSize++] = size >> 8;
+		stream[streamSize++] = size & 0xFF;
+		memcpy(stream + streamSize, buf, size);
+		streamSize += size;
+	}
+}
+
+static int check(OSCFraming framing) {
+	OSCPacketStream output = { NULL, NULL, writeFrame, NULL, NULL, NULL, &framing };
+	uint8_t blob[200];
+	int32_t value;
+	uint32_t i;
+
+	streamSize = 0;
+
+	for (value = 0; value < MESSAGE_COUNT; value++) {
+		OSCMessage *msg = OSCMessage_new();
+		OSCMessage_setAddress(msg, "/data");
+		OSCMessage_addArgument_int32(msg, value);
+		for (i = 0; i < (uint32_t)value % 200; i++)
+			blob[i] = blobByte(value, i);
+		OSCMessage_addArgument_blob(msg, blob, value % 200);
+		OSCMessage_sendMessage(msg, &output);
+		OSCMessage_delete(msg);
+	}
+
+	OSCServer *server = OSCServer_new(getTime);
+	OSCServer_addMessageHandler(server, "/data", handleMessage);
+	OSCFrameDecoder *decoder = OSCFrameDecoder_new(server, framing);
+
+	int sockets[2];
+	if (server == NULL || decoder == NULL || socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+		fprintf(stderr, "setup failed\n");
+		return 1;
+	}
+
+	/*
+	 * Random chunks through the socketpair
+	 */
+	uint8_t chunk[4096];
+	uint32_t sent = 0;
+	received = 0;
+	errors = 0;
+	srand(framing + 1);
+
+	while (sent < streamSize) {
+		uint32_t size = 1 + rand() % 700;
+		if (size > streamSize - sent)
+			size = streamSize - sent;
+
+		if (write(sockets[0], stream + sent, size) != (ssize_t)size)
+			errors++;
+		sent += size;
+
+		ssize_t length;
+		while ((length = recv(sockets[1], chunk, 1 + rand() % sizeof(chunk), MSG_DONTWAIT)) > 0) {
+			if (OSCFrameDecoder_decode(decoder, chunk, length) != OSC_OK)
+				errors++;
+		}
+	}
+
+	uint32_t chunked = received;
+
+	/*
+	 * The whole stream at once (every frame is handled in place)
+	 */
+	OSCFrameDecoder_reset(decoder);
+	if (OSCFrameDecoder_decode(decoder, stream, streamSize) != OSC_OK)
+		errors++;
+
+	uint32_t whole = received - chunked;
+
+	printf("%s: %u messages in random chunks, %u in one chunk, %u errors\n",
+			framing == OSC_FRAMING_SLIP ? "SLIP" : "size prefix", chunked, whole, errors);
+
+	OSCFrameDecoder_delete(decoder);
+	OSCServer_delete(server);
+	close(sockets[0]);
+	close(sockets[1]);
+
+	return (chunked == MESSAGE_COUNT && whole == MESSAGE_COUNT && errors == 0) ? 0 : 1;
+}
+
+int main(void) {
+	int failed = check(OSC_FRAMING_SLIP);
+	failed |= check(OSC_FRAMING_LENGTH);
+
+	return failed;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file	ServerAllocations.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Checks that a warmed-up OSCServer handles packets without allocating. All
+ * the memory of the server is taken through a counting OSCAllocator. The
+ * server is first fed a mix of immediate messages, bundles with wildcard
+ * addresses and bundles with a future timetag, until its buffers and pools
+ * have grown to fit. After that no allocation and no reallocation may happen
+ * in any of the following rounds of OSCServer_handlePacket and
+ * OSCServer_cycle (which reads the same packets from a stream).
+ *
+ * Build and run:
+ *
+ * 	gcc -std=gnu99 -DOSC_STATIC_ALLOCATION -DOSC_STATIC_MEMORY_SIZE=65536 -Iinc src/OSC/OSC*.c examples/ServerAllocations.c -o ServerAllocations
+ * 	./ServerAllocations
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "OSC/OSC.h"
+
+#define WARMUP_ROUNDS	16
+#define ROUNDS			10000
+#define ROUND_TIME		(1ULL << 28)	/* 1/16 s */
+#define PACKET_COUNT	3
+#define PACKET_SIZE		256
+#define CALLS_PER_ROUND	16	/* 1 + 3 (wildcard) + 4 (future, {1,2} twice), directly and by the cycle */
+
+typedef struct {
+	uint32_t mallocs;
+	uint32_t reallocs;
+} AllocationCount;
+
+typedef struct {
+	uint8_t data[PACKET_COUNT][PACKET_SIZE];
+	uint32_t size[PACKET_COUNT];
+	uint32_t next;		/* Packet which is read next, PACKET_COUNT if none is pending */
+} PacketQueue;
+
+static uint64_t now = 1000ULL << 32;
+static uint32_t handled;
+
+static void* countingAllocate(void *context, uint32_t size) {
+	((AllocationCount*)context)->mallocs++;
+	return OSCAllocator_malloc(&OSCAllocator_default, size);
+}
+
+static void* countingReallocate(void *context, void *ptr, uint32_t size) {
+	((AllocationCount*)context)->reallocs++;
+	return OSCAllocator_realloc(&OSCAllocator_default, ptr, size);
+}
+
+static void countingRelease(void *context, void *ptr) {
+	(void)context;
+	OSCAllocator_free(&OSCAllocator_default, ptr);
+}
+
+static uint64_t getTime(void) {
+	return now;
+}
+
+static void handler(OSCMessage *msg) {
+	(void)msg;
+	handled++;
+}
+
+static uint32_t queueGetPacketSize(void *context) {
+	PacketQueue *queue = (PacketQueue*)context;
+	return (queue->next < PACKET_COUNT) ? queue->size[queue->next] : 0;
+}
+
+static void queueReadPacket(void *context, uint8_t *buf) {
+	PacketQueue *queue = (PacketQueue*)context;
+	memcpy(buf, queue->data[queue->next], queue->size[queue->next]);
+	queue->next++;
+}
+
+static void setTimetag(uint8_t *packet, uint64_t timetag) {
+	uint32_t i;
+	for (i=0; i<8; i++)
+		packet[8+i] = (uint8_t)(timetag >> (56 - 8*i));	// big-endian, after "#bundle\0"
+}
+
+/*
+ * Builds the packets with the default allocator, so they are not counted
+ */
+static int buildPackets(PacketQueue *queue) {
+	OSCMessage *msg = OSCMessage_new();
+	OSCBundle *bundle = OSCBundle_new();
+	OSCBundle *future = OSCBundle_new();
+	int failed = (msg == NULL || bundle == NULL || future == NULL);
+
+	if (!failed) {
+		OSCMessage_setAddress(msg, "/mixer/1/fader");
+		OSCMessage_addArgument_float(msg, 0.5f);
+		failed |= (OSCMessage_encode(msg, queue->data[0], PACKET_SIZE, &queue->size[0]) != OSC_OK);
+
+		OSCBundle_addMessage(bundle, msg);
+		OSCMessage_setAddress(msg, "/mixer/*/mute");
+		OSCMessage_addArgument_string(msg, "on");
+		OSCBundle_addMessage(bundle, msg);
+		failed |= (OSCBundle_encode(bundle, queue->data[1], PACKET_SIZE, &queue->size[1]) != OSC_OK);
+
+		OSCMessage_setAddress(msg, "/mixer/{1,2}/fader");
+		OSCBundle_addMessage(future, msg);
+		OSCBundle_addMessage(future, msg);
+		failed |= (OSCBundle_encode(future, queue->data[2], PACKET_SIZE, &queue->size[2]) != OSC_OK);
+	}
+
+	if (msg != NULL)
+		OSCMessage_delete(msg);
+	if (bundle != NULL)
+		OSCBundle_delete(bundle);
+	if (future != NULL)
+		OSCBundle_delete(future);
+
+	return failed;
+}
+
+/*
+ * One round: the packets are handled directly and then read by a cycle. The future bundle
+ * is due two rounds later, so there are always stored messages waiting.
+ */
+static void runRound(OSCServer *server, PacketQueue *queue, OSCPacketStream *stream) {
+	uint32_t i;
+
+	now += ROUND_TIME;
+	setTimetag(queue->data[2], now + 2*ROUND_TIME);
+
+	for (i=0; i<PACKET_COUNT; i++)
+		OSCServer_handlePacket(server, queue->data[i], queue->size[i]);
+
+	queue->next = 0;
+	OSCServer_cycle(server, stream);
+}
+
+int main(void) {
+	AllocationCount count = { 0, 0 };
+	OSCAllocator allocator = { countingAllocate, countingReallocate, countingRelease, &count };
+	PacketQueue queue;
+	OSCPacketStream stream = { queueGetPacketSize, queueReadPacket, NULL, NULL, NULL, NULL, &queue };
+	uint32_t i;
+
+	queue.next = PACKET_COUNT;
+
+	if (buildPackets(&queue) != 0) {
+		printf("cannot build the packets\n");
+		return 1;
+	}
+
+	OSCServer *server = OSCServer_newWithAllocator(getTime, &allocator);
+
+	if (server == NULL) {
+		printf("cannot create the server\n");
+		return 1;
+	}
+
+	OSCServer_addMessageHandler(server, "/mixer/1/fader", handler);
+	OSCServer_addMessageHandler(server, "/mixer/2/fader", handler);
+	OSCServer_addMessageHandler(server, "/mixer/1/mute", handler);
+	OSCServer_addMessageHandler(server, "/mixer/2/mute", handler);
+
+	for (i=0; i<WARMUP_ROUNDS; i++)
+		runRound(server, &queue, &stream);
+
+	printf("warm-up: %u allocations, %u reallocations\n", count.mallocs, count.reallocs);
+
+	count.mallocs = count.reallocs = 0;
+	handled = 0;
+
+	for (i=0; i<ROUNDS; i++)
+		runRound(server, &queue, &stream);
+
+	printf("%d rounds: %u handler calls, %u allocations, %u reallocations\n", ROUNDS, handled, count.mallocs, count.reallocs);
+
+	OSCServer_delete(server);
+
+	return (handled != ROUNDS*CALLS_PER_ROUND || count.mallocs != 0 || count.reallocs != 0);
+}
@@ -0,0 +1,149 @@
+/**
+ * @file	SharedRingFork.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Checks OSCSharedRing between two processes. The parent formats a ring in
+ * anonymous shared memory and forks a writer, which sends 200000 messages of
+ * different sizes (through sendMessage, the stream interface and an empty
+ * packet now and then) and waits whenever the ring is full. The parent reads
+ * them with OSCSharedRing_handlePackets and OSCServer_cycle in turns. Every
+ * message must arrive once and in order.
+ *
+ * Build and run (Linux):
+ *
+ * 	gcc -std=gnu99 -DOSC_STATIC_ALLOCATION -DOSC_STATIC_MEMORY_SIZE=65536 -Iinc src/OSC/OSC*.c examples/SharedRingFork.c -o SharedRingFork
+ * 	./SharedRingFork
+ *
+ */
+
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "OSC/OSC.h"
+
+#define RING_CAPACITY	4096
+#define MESSAGE_COUNT	200000
+
+static int32_t next, errors;
+
+static uint64_t getTime(void) {
+	return OSCTimetag_immediately;
+}
+
+static void handleMessage(OSCMessage *oscMessage) {
+	if (OSCMessage_getArgument_int32(oscMessage, 0) != next)
+		errors++;
+
+	next++;
+}
+
+static void writeMessages(void *memory) {
+	OSCSharedRing *ring = OSCSharedRing_open(memory);
+	int32_t i;
+
+	if (ring == NULL)
+		_exit(1);
+
+	for (i = 0; i < MESSAGE_COUNT; i++) {
+		OSCMessage *msg = OSCMessage_new();
+		OSCMessage_setAddress(msg, "/value");
+		OSCMessage_addArgument_int32(msg, i);
+		if (i % 3 == 0)
+			OSCMessage_addArgument_string(msg, "some padding text");
+
+		if (i % 1000 == 999) {	// empty packets are skipped by the reader
+			while (OSCSharedRing_reserve(ring, 0) == NULL)
+				sched_yield();
+			OSCSharedRing_commit(ring, 0);
+		}
+
+		if (i % 2) {
+			while (OSCSharedRing_sendMessage(ring, msg) != OSC_OK)
+				sched_yield();
+		} else {
+			/* The stream drops a packet which does not fit, so wait for the space first */
+			while (OSCSharedRing_reserve(ring, OSCMessage_getPaddedLength(msg)) == NULL)
+				sched_yield();
+			OSCMessage_sendMessage(msg, OSCSharedRing_getStream(ring));
+		}
+
+		OSCMessage_delete(msg);
+	}
+
+	OSCSharedRing_close(ring);
+	_exit(0);
+}
+
+int main(void) {
+	uint32_t size = OSCSharedRing_getMemorySize(RING_CAPACITY);
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (memory == MAP_FAILED || OSCSharedRing_format(memory, size) != OSC_OK) {
+		fprintf(stderr, "setup failed\n");
+		return 1;
+	}
+
+	pid_t writer = fork();
+
+	if (writer < 0)
+		return 1;
+
+	if (writer == 0)
+		writeMessages(memory);
+
+	OSCSharedRing *ring = OSCSharedRing_open(memory);
+	OSCServer *server = OSCServer_new(getTime);
+	OSCServer_addMessageHandler(server, "/value", handleMessage);
+
+	int status, turn = 0;
+	while (1) {
+		if (turn++ % 2)
+			OSCSharedRing_handlePackets(ring, server);
+		else
+			OSCServer_cycle(server, OSCSharedRing_getStream(ring));
+
+		if (waitpid(writer, &status, WNOHANG) == writer) {
+			OSCSharedRing_handlePackets(ring, server);	// the rest of the ring
+			break;
+		}
+
+		sched_yield();
+	}
+
+	printf("%d messages received, %d out of order\n", next, errors);
+
+	OSCServer_delete(server);
+	OSCSharedRing_close(ring);
+	munmap(memory, size);
+
+	return (next == MESSAGE_COUNT && errors == 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+}
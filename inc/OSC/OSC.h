@@ -50,10 +50,22 @@
 #ifndef OSC_H_
 #define OSC_H_
 
+#include "OSCAllocator.h"
+#include "OSCBatchSender.h"
 #include "OSCBundle.h"
+#include "OSCConfig.h"
+#include "OSCFrameDecoder.h"
 #include "OSCMessage.h"
+#include "OSCMessageView.h"
+#include "OSCPattern.h"
 #include "OSCPacketStream.h"
 #include "OSCServer.h"
+#include "OSCSharedRing.h"
+#include "OSCWriter.h"
+
+#ifdef OSC_THREADS
+#include "OSCThreadedServer.h"
+#endif
 
 
 #endif /* OSC_H_ */
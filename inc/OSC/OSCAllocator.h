@@ -0,0 +1,61 @@
+/**
+ * @file	OSCAllocator.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCAllocator - interface-like structure which describes the memory allocator
+ * used by OSCServer, OSCMessage, OSCBundle and OSCPattern. The default allocator
+ * uses MemoryManager functions.
+ *
+ */
+
+#ifndef OSCALLOCATOR_H_
+#define OSCALLOCATOR_H_
+
+#include <stdint.h>
+#include "OSCConfig.h"
+
+typedef struct _OSCAllocator {
+	void* (*allocate)(void *context, uint32_t size);				/**< Function that allocates size bytes or returns NULL */
+	void* (*reallocate)(void *context, void *ptr, uint32_t size);	/**< Function that resizes the allocated memory (ptr can be NULL) or returns NULL */
+	void (*release)(void *context, void *ptr);						/**< Function that frees the allocated memory (ptr can be NULL) */
+	void *context;													/**< User data which is passed to the functions */
+} OSCAllocator;
+
+/**
+ * The default allocator (MemoryManager_malloc, MemoryManager_realloc and MemoryManager_free
+ * or the static memory block if OSC_STATIC_ALLOCATION is defined). It is used when NULL is
+ * passed instead of the allocator.
+ */
+extern OSCAllocator OSCAllocator_default;
+
+void*	OSCAllocator_malloc(OSCAllocator *allocator, uint32_t size);
+void*	OSCAllocator_realloc(OSCAllocator *allocator, void *ptr, uint32_t size);
+void	OSCAllocator_free(OSCAllocator *allocator, void *ptr);
+
+#endif /* OSCALLOCATOR_H_ */
@@ -0,0 +1,139 @@
+/**
+ * @file	OSCBatchSender.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCBatchSender - sends the messages in batches. Outgoing messages are encoded
+ * into a bundle of at most one MTU, which is written to an OSCPacketStream as a
+ * single packet when the next message does not fit, when the oldest queued
+ * message has waited for the latency, or when the sender is flushed. Small
+ * messages then cost a fraction of a packet (and of a system call) each, while
+ * the added latency stays bounded.
+ *
+ * The latency is checked when a message is sent and by OSCBatchSender_poll,
+ * which should be called from the main loop (OSCBatchSender_getTimeout tells
+ * when) so that the last messages of a burst are not held back.
+ *
+ */
+
+#ifndef OSCBATCHSENDER_H_
+#define OSCBATCHSENDER_H_
+
+#include <stdint.h>
+#include "OSCMessage.h"
+#include "OSCPacketStream.h"
+#include "OSCServer.h"
+
+/**
+ * \struct OSCBatchSender is a structure which represents a queue of outgoing messages and
+ * has all private (hidden) members. OSCBatchSender should only be referenced as a pointer.
+ */
+typedef struct _OSCBatchSender OSCBatchSender;
+
+/**
+ * Creates a new instance of OSCBatchSender.
+ *
+ * @param stream A pointer to the stream the packets are written to. The stream must stay
+ * valid until the sender is deleted.
+ *
+ * @param mtu A maximum size of the packet in bytes (at least 28, e.g. 1472 for UDP over
+ * Ethernet).
+ *
+ * @param func A function which returns the current time (OSCTimetag) or NULL if the
+ * messages are sent only when the packet is full or the sender is flushed.
+ *
+ * @return A pointer to a newly created OSCBatchSender or NULL if error occurred.
+ */
+OSCBatchSender*	OSCBatchSender_new(OSCPacketStream *stream, uint32_t mtu, OSCTimetag_get func);
+
+/**
+ * Creates a new instance of OSCBatchSender which allocates its memory using the allocator.
+ *
+ * @param allocator A pointer to the allocator or NULL to use the default one. The allocator
+ * must stay valid until the sender is deleted.
+ *
+ * @return A pointer to a newly created OSCBatchSender or NULL if error occurred.
+ */
+OSCBatchSender*	OSCBatchSender_newWithAllocator(OSCPacketStream *stream, uint32_t mtu, OSCTimetag_get func, OSCAllocator *allocator);
+
+/**
+ * Frees the resources allocated by the OSCBatchSender. Queued messages are dropped, call
+ * OSCBatchSender_flush first to send them.
+ *
+ * @param sender A pointer to the OSCBatchSender instance.
+ */
+void		OSCBatchSender_delete(OSCBatchSender *sender);
+
+/**
+ * Sets the time a message can wait in the queue.
+ *
+ * @param sender A pointer to the OSCBatchSender instance.
+ *
+ * @param latency A time in microseconds (the default is OSC_BATCH_LATENCY).
+ */
+void		OSCBatchSender_setLatency(OSCBatchSender *sender, uint32_t latency);
+
+/**
+ * Queues the message (it is encoded right away, so it can be modified or deleted when the
+ * function returns). The queued messages are sent first if the message does not fit into
+ * the packet, and the packet is sent if the latency has expired. A message which is larger
+ * than the MTU is sent in a packet of its own.
+ *
+ * @param sender A pointer to the OSCBatchSender instance.
+ *
+ * @param oscMessage A pointer to the message.
+ *
+ * @return OSC_OK or OSC_ALLOC_FAILED if a message larger than the MTU could not be sent.
+ */
+OSCResult	OSCBatchSender_sendMessage(OSCBatchSender *sender, OSCMessage *oscMessage);
+
+/**
+ * Sends the queued messages. A single message is sent as is, without a bundle.
+ *
+ * @param sender A pointer to the OSCBatchSender instance.
+ */
+void		OSCBatchSender_flush(OSCBatchSender *sender);
+
+/**
+ * Sends the queued messages if the oldest of them has waited for the latency.
+ *
+ * @param sender A pointer to the OSCBatchSender instance.
+ */
+void		OSCBatchSender_poll(OSCBatchSender *sender);
+
+/**
+ * Returns the time until the queued messages are due.
+ *
+ * @param sender A pointer to the OSCBatchSender instance.
+ *
+ * @return A time in microseconds (0 if the messages are already due) or OSC_WAIT_FOREVER if
+ * there are no queued messages or no time function.
+ */
+uint32_t	OSCBatchSender_getTimeout(OSCBatchSender *sender);
+
+#endif /* OSCBATCHSENDER_H_ */
@@ -54,7 +54,9 @@ typedef union _OSCTimetag {
 typedef struct _OSCBundle OSCBundle;
 
 OSCBundle*	OSCBundle_new(void);
+OSCBundle*	OSCBundle_newWithAllocator(OSCAllocator *allocator);
 OSCBundle*	OSCBundle_clone(OSCBundle *oscBundle);
+OSCBundle*	OSCBundle_cloneWithAllocator(OSCBundle *oscBundle, OSCAllocator *allocator);
 void		OSCBundle_delete(OSCBundle *oscBundle);
 
 void		OSCBundle_setTimetag(OSCBundle *oscBundle, uint64_t timetag);
@@ -62,8 +64,22 @@ void		OSCBundle_setTimetag(OSCBundle *oscBundle, uint64_t timetag);
 OSCResult	OSCBundle_addMessage(OSCBundle *oscBundle, OSCMessage *oscMessage);
 OSCResult	OSCBundle_addBundle(OSCBundle *oscBundle, OSCBundle *oscBundleIn);
 
+/*
+ * Add the message (bundle) itself instead of a copy. On success the bundle takes the ownership:
+ * the element is deleted together with the bundle and must not be modified or deleted by the
+ * caller. On failure the caller keeps the ownership.
+ */
+OSCResult	OSCBundle_adoptMessage(OSCBundle *oscBundle, OSCMessage *oscMessage);
+OSCResult	OSCBundle_adoptBundle(OSCBundle *oscBundle, OSCBundle *oscBundleIn);
+
 OSCResult	OSCBundle_sendBundle(OSCBundle *oscBundle, OSCPacketStream *stream);
 uint32_t	OSCBundle_getPaddedLength(OSCBundle *oscBundle);
 void		OSCBundle_dump(OSCBundle *oscBundle, uint8_t *data);
 
+/*
+ * Encodes the bundle into the buffer of the given capacity. On return *size (if not NULL)
+ * is the encoded size, or the required size if the result is OSC_BUFFER_TOO_SMALL.
+ */
+OSCResult	OSCBundle_encode(OSCBundle *oscBundle, uint8_t *buffer, uint32_t capacity, uint32_t *size);
+
 #endif /* OSCBUNDLE_H_ */
@@ -0,0 +1,128 @@
+/**
+ * @file	OSCConfig.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCConfig - compile-time configuration of the OSC library. Every option can be
+ * overridden by defining it before this file is included (e.g. with -D).
+ *
+ * When OSC_STATIC_ALLOCATION is defined, the library does not use MemoryManager.
+ * All the memory (of OSCServer, OSCMessage, OSCBundle and OSCPattern instances)
+ * is taken from a static block of OSC_STATIC_MEMORY_SIZE bytes, so the memory use
+ * is known at link time. Allocation fails with OSC_ALLOC_FAILED when the block
+ * or one of the limits below is exhausted.
+ *
+ */
+
+#ifndef OSCCONFIG_H_
+#define OSCCONFIG_H_
+
+/* #define OSC_STATIC_ALLOCATION */
+
+/* #define OSC_THREADS */	/* Build OSCThreadedServer (requires POSIX threads) */
+
+#ifdef OSC_STATIC_ALLOCATION
+
+#ifndef OSC_STATIC_MEMORY_SIZE
+#define OSC_STATIC_MEMORY_SIZE	16384	/* Size of the static memory block (power of two) */
+#endif
+
+#ifndef OSC_MAX_HANDLERS
+#define OSC_MAX_HANDLERS		32
+#endif
+
+#ifndef OSC_MAX_QUEUED_MESSAGES
+#define OSC_MAX_QUEUED_MESSAGES	16
+#endif
+
+#ifndef OSC_MAX_ARGUMENTS
+#define OSC_MAX_ARGUMENTS		16
+#endif
+
+#ifndef OSC_MAX_PACKET_SIZE
+#define OSC_MAX_PACKET_SIZE		512
+#endif
+
+#ifndef OSC_BATCH_SIZE
+#define OSC_BATCH_SIZE			4
+#endif
+
+#endif /* OSC_STATIC_ALLOCATION */
+
+/*
+ * Limits, 0 means there is no limit
+ */
+#ifndef OSC_MAX_HANDLERS
+#define OSC_MAX_HANDLERS		0	/* Number of handlers an OSCServer can have */
+#endif
+
+#ifndef OSC_MAX_QUEUED_MESSAGES
+#define OSC_MAX_QUEUED_MESSAGES	0	/* Number of messages an OSCServer can keep for later cycles */
+#endif
+
+#ifndef OSC_MAX_ARGUMENTS
+#define OSC_MAX_ARGUMENTS		0	/* Number of arguments an OSCMessage can have */
+#endif
+
+#ifndef OSC_MAX_PACKET_SIZE
+#define OSC_MAX_PACKET_SIZE		0	/* Default maximum size of the packet received by an OSCServer */
+#endif
+
+/*
+ * Batched receive (used with the streams which implement readPackets)
+ */
+#ifndef OSC_BATCH_SIZE
+#define OSC_BATCH_SIZE			16	/* Number of packets read by one readPackets call */
+#endif
+
+#ifndef OSC_BATCH_SLOT_SIZE
+#define OSC_BATCH_SLOT_SIZE		1536	/* Initial buffer size of one packet in the batch if there is no maximum packet size (grows to the largest packet received) */
+#endif
+
+/*
+ * Waiting for several streams without an OSCWaiter (see OSCServer_wait)
+ */
+#ifndef OSC_WAIT_SLICE
+#define OSC_WAIT_SLICE			1000	/* Longest time (in microseconds) one of the streams is waited for */
+#endif
+
+/*
+ * Streaming writer
+ */
+#ifndef OSC_WRITER_MAX_DEPTH
+#define OSC_WRITER_MAX_DEPTH	8	/* Number of elements (nested bundles and a message) an OSCWriter can have open */
+#endif
+
+/*
+ * Batching sender
+ */
+#ifndef OSC_BATCH_LATENCY
+#define OSC_BATCH_LATENCY		1000	/* Default time (in microseconds) a message can wait in an OSCBatchSender */
+#endif
+
+#endif /* OSCCONFIG_H_ */
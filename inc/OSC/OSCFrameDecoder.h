@@ -0,0 +1,125 @@
+/**
+ * @file	OSCFrameDecoder.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCFrameDecoder - incremental decoder of the OSC packets which are sent over a
+ * byte stream (e.g. TCP or a serial line). Data is pushed in chunks of any size
+ * and every complete frame is handled by an OSCServer, just like a received
+ * packet. Frames which are contained in a single chunk (and need no unescaping)
+ * are handled in place, only the frames split between the chunks are copied.
+ *
+ * Both OSC stream framings are supported: SLIP (OSC 1.1, RFC 1055 with an END
+ * byte at both ends of a packet) and a 32-bit big-endian size before every
+ * packet (OSC 1.0).
+ *
+ */
+
+#ifndef OSCFRAMEDECODER_H_
+#define OSCFRAMEDECODER_H_
+
+#include <stdint.h>
+#include "OSCServer.h"
+
+typedef enum {
+	OSC_FRAMING_SLIP,		/**< SLIP encoded packets (OSC 1.1) */
+	OSC_FRAMING_LENGTH		/**< Packets prefixed with a 32-bit big-endian size (OSC 1.0) */
+} OSCFraming;
+
+/**
+ * \struct OSCFrameDecoder is a structure which represents the decoding state of a byte
+ * stream and has all private (hidden) members. OSCFrameDecoder should only be referenced
+ * as a pointer.
+ */
+typedef struct _OSCFrameDecoder OSCFrameDecoder;
+
+/**
+ * Creates a new instance of OSCFrameDecoder.
+ *
+ * @param oscServer A pointer to the OSCServer instance which handles the decoded packets.
+ *
+ * @param framing A framing of the stream.
+ *
+ * @return A pointer to a newly created OSCFrameDecoder or NULL if error occurred.
+ */
+OSCFrameDecoder*	OSCFrameDecoder_new(OSCServer *oscServer, OSCFraming framing);
+
+/**
+ * Creates a new instance of OSCFrameDecoder which allocates its memory using the allocator.
+ *
+ * @param oscServer A pointer to the OSCServer instance which handles the decoded packets.
+ *
+ * @param framing A framing of the stream.
+ *
+ * @param allocator A pointer to the allocator or NULL to use the default one. The allocator
+ * must stay valid until the decoder is deleted.
+ *
+ * @return A pointer to a newly created OSCFrameDecoder or NULL if error occurred.
+ */
+OSCFrameDecoder*	OSCFrameDecoder_newWithAllocator(OSCServer *oscServer, OSCFraming framing, OSCAllocator *allocator);
+
+/**
+ * Frees the resources allocated by the OSCFrameDecoder.
+ *
+ * @param decoder A pointer to the OSCFrameDecoder instance.
+ */
+void		OSCFrameDecoder_delete(OSCFrameDecoder *decoder);
+
+/**
+ * Sets the maximum size of the frame. Larger frames are skipped.
+ *
+ * @param decoder A pointer to the OSCFrameDecoder instance.
+ *
+ * @param size A maximum frame size in bytes or 0 if there is no limit (the default is
+ * OSC_MAX_PACKET_SIZE).
+ */
+void		OSCFrameDecoder_setMaxFrameSize(OSCFrameDecoder *decoder, uint32_t size);
+
+/**
+ * Drops the partially received frame (e.g. when the connection is reopened).
+ *
+ * @param decoder A pointer to the OSCFrameDecoder instance.
+ */
+void		OSCFrameDecoder_reset(OSCFrameDecoder *decoder);
+
+/**
+ * Decodes a chunk of the stream. Every frame which is completed by the chunk is passed to
+ * OSCServer_handlePacket, so the function must not be called from a message handler.
+ *
+ * @param decoder A pointer to the OSCFrameDecoder instance.
+ *
+ * @param data A pointer to the chunk (it is not modified).
+ *
+ * @param size A size of the chunk in bytes.
+ *
+ * @return OSC_OK or OSC_ALLOC_FAILED if a frame was skipped because it could not be
+ * buffered (the rest of the chunk is still decoded).
+ */
+OSCResult	OSCFrameDecoder_decode(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size);
+
+#endif /* OSCFRAMEDECODER_H_ */
@@ -37,36 +37,60 @@
 #define OSCMESSAGE_H_
 
 #include <stdint.h>
+#include "OSCAllocator.h"
 #include "OSCPacketStream.h"
 
-typedef enum { OSC_OK=0, OSC_ERROR=1, OSC_ALLOC_FAILED, OSC_FORMAT_ERROR } OSCResult;
+typedef enum { OSC_OK=0, OSC_ERROR=1, OSC_ALLOC_FAILED, OSC_FORMAT_ERROR, OSC_BUFFER_TOO_SMALL } OSCResult;
 
 typedef struct _OSCMessage OSCMessage;
+typedef struct _OSCMessageView OSCMessageView;
 
 OSCMessage*	OSCMessage_new(void);
+OSCMessage*	OSCMessage_newWithAllocator(OSCAllocator *allocator);
 OSCMessage* OSCMessage_clone(OSCMessage *oscMessage);
+OSCMessage*	OSCMessage_cloneWithAllocator(OSCMessage *oscMessage, OSCAllocator *allocator);
+OSCResult	OSCMessage_copy(OSCMessage *oscMessage, OSCMessage *source);
+OSCMessage*	OSCMessage_newFromView(OSCMessageView *view);
+OSCMessage*	OSCMessage_newFromViewWithAllocator(OSCMessageView *view, OSCAllocator *allocator);
 void		OSCMessage_delete(OSCMessage *oscMessage);
 
 OSCResult	OSCMessage_setAddress(OSCMessage *oscMessage, const char* str);
-char*		OSCMessage_getAddress(OSCMessage *oscMessage);
+const char*	OSCMessage_getAddress(OSCMessage *oscMessage);
 
 
 OSCResult	OSCMessage_addArgument_int32(OSCMessage *oscMessage, int32_t i);
 OSCResult	OSCMessage_addArgument_float(OSCMessage *oscMessage, float f);
 OSCResult	OSCMessage_addArgument_string(OSCMessage *oscMessage, const char* s);
-OSCResult	OSCMessage_addArgument_blob(OSCMessage *oscMessage, uint8_t *blob, int32_t size);
+OSCResult	OSCMessage_addArgument_blob(OSCMessage *oscMessage, const uint8_t *blob, int32_t size);
 
 uint32_t	OSCMessage_getArgumentCount(OSCMessage *oscMessage);
 char		OSCMessage_getArgumentType(OSCMessage *oscMessage, uint32_t position);
 
+/*
+ * int32 and float read an 'i' or 'f' argument (as its raw bits), string reads an 's' argument
+ * and blob reads a 'b' or 's' argument. A missing argument or one of another type gives 0 or
+ * NULL (and size 0), the same for a message which owns its data and for a view.
+ *
+ * The address, string and blob data are read-only: clones share them until one of them is
+ * modified through the OSCMessage functions.
+ */
 int32_t		OSCMessage_getArgument_int32 (OSCMessage *oscMessage, uint32_t position);
 float		OSCMessage_getArgument_float(OSCMessage *oscMessage, uint32_t position);
-char*		OSCMessage_getArgument_string(OSCMessage *oscMessage, uint32_t position);
-uint8_t*	OSCMessage_getArgument_blob(OSCMessage *oscMessage, uint32_t position, uint32_t *size);
+const char*	OSCMessage_getArgument_string(OSCMessage *oscMessage, uint32_t position);
+const uint8_t*	OSCMessage_getArgument_blob(OSCMessage *oscMessage, uint32_t position, uint32_t *size);
+
+void		OSCMessage_setView(OSCMessage *oscMessage, OSCMessageView *view);
+OSCResult	OSCMessage_setFromView(OSCMessage *oscMessage, OSCMessageView *view);
 
 OSCResult	OSCMessage_sendMessage(OSCMessage *oscMessage, OSCPacketStream *stream);
 uint32_t	OSCMessage_getPaddedLength(OSCMessage *oscMessage);
 void		OSCMessage_dump(OSCMessage *oscMessage, uint8_t *data);
 
+/*
+ * Encodes the message into the buffer of the given capacity. On return *size (if not NULL)
+ * is the encoded size, or the required size if the result is OSC_BUFFER_TOO_SMALL.
+ */
+OSCResult	OSCMessage_encode(OSCMessage *oscMessage, uint8_t *buffer, uint32_t capacity, uint32_t *size);
+
 
 #endif /* OSCMESSAGE_H_ */
@@ -0,0 +1,82 @@
+/**
+ * @file	OSCMessageView.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCMessageView - read-only view of an encoded OSC message. The view points into
+ * the buffer it was initialized with and decodes arguments only when they are
+ * requested, so no message data is copied. The buffer must stay valid (and
+ * unchanged) for as long as the view is used.
+ *
+ */
+
+#ifndef OSCMESSAGEVIEW_H_
+#define OSCMESSAGEVIEW_H_
+
+#include <stdint.h>
+#include "OSCMessage.h"
+
+/**
+ * \struct OSCMessageView describes an encoded message. Members should not be accessed
+ * directly, the structure is public only so that views can be kept on the stack.
+ */
+struct _OSCMessageView {
+	uint8_t *data;				/* Start of the encoded message (the address) */
+	uint32_t size;				/* Size of the encoded message */
+	char *types;				/* Argument type string descriptor (without the ',') */
+	uint32_t argumentCount;		/* Number of arguments */
+	uint8_t *arguments;			/* First argument */
+	uint32_t cursorPosition;	/* Position of the last looked up argument */
+	uint8_t *cursor;			/* Contents of the last looked up argument */
+};
+
+/**
+ * Initializes a view of an encoded message. The whole message is validated, so the
+ * getters do not need to do any bounds checking.
+ *
+ * @param view A pointer to the view to initialize.
+ *
+ * @param data A pointer to the encoded message.
+ *
+ * @param size Size of the encoded message.
+ *
+ * @return OSC_OK if data contains a valid message or OSC_FORMAT_ERROR.
+ */
+OSCResult	OSCMessageView_init(OSCMessageView *view, uint8_t *data, uint32_t size);
+
+char*		OSCMessageView_getAddress(OSCMessageView *view);
+
+uint32_t	OSCMessageView_getArgumentCount(OSCMessageView *view);
+char		OSCMessageView_getArgumentType(OSCMessageView *view, uint32_t position);
+
+int32_t		OSCMessageView_getArgument_int32(OSCMessageView *view, uint32_t position);
+float		OSCMessageView_getArgument_float(OSCMessageView *view, uint32_t position);
+char*		OSCMessageView_getArgument_string(OSCMessageView *view, uint32_t position);
+uint8_t*	OSCMessageView_getArgument_blob(OSCMessageView *view, uint32_t position, uint32_t *size);
+
+#endif /* OSCMESSAGEVIEW_H_ */
@@ -43,4 +43,10 @@ static inline uint32_t OSCMisc_getPaddedLength(uint32_t size) {
 
 uint8_t OSCMisc_matchStringPattern(const char *str, const char *p);
 
+/*
+ * Converts a timetag difference (32.32 fixed point seconds) to a timeout in microseconds
+ * (rounded up, always less than OSC_WAIT_FOREVER)
+ */
+uint32_t OSCMisc_getTimeout(uint64_t difference);
+
 #endif /* OSCMISC_H_ */
@@ -30,7 +30,8 @@
  *
  * OSCPacketStream defines the interface which is used by the OSC library and
  * should be implemented by the library user to be able to send and receive
- * packets.
+ * packets. Every function gets the context of the stream, so the same functions
+ * can serve any number of streams.
  *
  */
 
@@ -39,11 +40,26 @@
 #define OSCPACKETSTREAM_H_
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#define OSC_WAIT_FOREVER	0xffffffff
+
+/**
+ * A buffer for one packet of a batch (see readPackets).
+ */
+typedef struct {
+	uint8_t *buf;		/**< Buffer for the packet */
+	uint32_t size;		/**< Size of the buffer, set to the packet size when the packet is read (any value larger than the buffer size means the packet did not fit, the full size of the packet should be set if it is known) */
+} OSCPacketSlot;
 
 typedef struct _OSCPacketStream {
-	uint32_t (*getPacketSize)(void);		/**< Function that returns packet size or 0 if no packet is pending */
-	void (*readPacket)(uint8_t *buf);		/**< Function that reads the contents of the packet and writes it to the buffer */
-	void (*writePacket)(uint8_t *buf, uint32_t size);	/**< Function that forms a packet from the buffer and sends it */
+	uint32_t (*getPacketSize)(void *context);		/**< Function that returns packet size or 0 if no packet is pending */
+	void (*readPacket)(void *context, uint8_t *buf);		/**< Function that reads the contents of the packet and writes it to the buffer */
+	void (*writePacket)(void *context, uint8_t *buf, uint32_t size);	/**< Function that forms a packet from the buffer and sends it */
+	void (*waitPacket)(void *context, uint32_t timeout);	/**< Optional (can be NULL): function that returns when a packet is pending or the timeout (in microseconds, OSC_WAIT_FOREVER for none) expires */
+	uint32_t (*readPackets)(void *context, OSCPacketSlot *slots, uint32_t count);	/**< Optional (can be NULL): function that reads up to count pending packets into the slots (without blocking) and returns the number of packets read */
+	void (*skipPacket)(void *context);		/**< Optional (can be NULL): function that drops the pending packet without reading it. Streams which implement neither skipPacket nor readPackets need memory for the whole packet to drop a packet which is too large */
+	void *context;		/**< User data which is passed to every function (e.g. a socket of this stream) */
 } OSCPacketStream;
 
 #endif /* OSCPACKETSTREAM_H_ */
@@ -0,0 +1,106 @@
+/**
+ * @file	OSCPattern.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCPattern - OSC address pattern compiled into a matching program. A pattern
+ * is compiled once and can then be matched against any number of addresses.
+ * Matching simulates all the possible pattern positions at once, so it takes
+ * time proportional to the address length times the pattern length, no matter
+ * how many '*' or '{}' the pattern contains.
+ *
+ */
+
+#ifndef OSCPATTERN_H_
+#define OSCPATTERN_H_
+
+#include <stdint.h>
+#include "OSCMessage.h"
+
+/**
+ * \struct OSCPattern is a structure which represents a compiled address pattern and has
+ * all private (hidden) members. OSCPattern should only be referenced as a pointer.
+ */
+typedef struct _OSCPattern OSCPattern;
+
+/**
+ * Creates a new (empty) instance of OSCPattern.
+ *
+ * @return A pointer to a newly created OSCPattern or NULL if error occurred.
+ */
+OSCPattern*	OSCPattern_new(void);
+
+/**
+ * Creates a new (empty) instance of OSCPattern which allocates its memory using the allocator.
+ *
+ * @param allocator A pointer to the allocator or NULL to use the default one. The allocator
+ * must stay valid until the pattern is deleted.
+ *
+ * @return A pointer to a newly created OSCPattern or NULL if error occurred.
+ */
+OSCPattern*	OSCPattern_newWithAllocator(OSCAllocator *allocator);
+
+/**
+ * Frees the resources allocated by the OSCPattern.
+ *
+ * @param oscPattern A pointer to the OSCPattern instance.
+ */
+void		OSCPattern_delete(OSCPattern *oscPattern);
+
+/**
+ * Compiles the address pattern. Memory allocated for the previous pattern is reused.
+ *
+ * @param oscPattern A pointer to the OSCPattern instance.
+ *
+ * @param pattern An address pattern, e.g. "/mixer/ch/{1,2}/[a-f]*".
+ *
+ * @return OSC_OK if the pattern was compiled, OSC_FORMAT_ERROR if the pattern is not
+ * valid or OSC_ALLOC_FAILED.
+ */
+OSCResult	OSCPattern_compile(OSCPattern *oscPattern, const char *pattern);
+
+/**
+ * Returns the number of '/' separated segments in the compiled pattern.
+ */
+uint32_t	OSCPattern_getSegmentCount(OSCPattern *oscPattern);
+
+/**
+ * Matches one segment of the compiled pattern against a name (which must not contain '/').
+ *
+ * @return 1 if the name matches the segment, 0 otherwise.
+ */
+uint8_t		OSCPattern_matchSegment(OSCPattern *oscPattern, uint32_t segment, const char *name);
+
+/**
+ * Matches the compiled pattern against an address.
+ *
+ * @return 1 if the address matches the pattern, 0 otherwise.
+ */
+uint8_t		OSCPattern_match(OSCPattern *oscPattern, const char *address);
+
+#endif /* OSCPATTERN_H_ */
@@ -47,6 +47,7 @@
 
 #include "OSCMessage.h"
 #include "OSCPacketStream.h"
+#include "OSCPattern.h"
 
 /**
  * \struct OSCServer is a structure which represents OSCServer instance and has all
@@ -59,9 +60,22 @@ typedef struct _OSCServer OSCServer;
  */
 typedef void (*OSCMethod)(OSCMessage* oscMessage);
 
+/**
+ * \typedef OSCDispatcher describe the format of the function which replaces calling the
+ * handlers directly (see OSCServer_setDispatcher). It should return non-zero if the message
+ * was taken care of.
+ */
+typedef uint8_t (*OSCDispatcher)(void *context, OSCMessage *oscMessage);
 
 typedef uint64_t (*OSCTimetag_get)(void);
 
+/**
+ * \typedef OSCWaiter describes the format of the function which waits for the packets of
+ * all the streams at once (see OSCServer_setWaiter). It should return when a packet is
+ * pending on any of the streams or the timeout (in microseconds) expires.
+ */
+typedef void (*OSCWaiter)(void *context, uint32_t timeout);
+
 /**
  * Creates a new instance of OSCServer.
  *
@@ -71,6 +85,19 @@ typedef uint64_t (*OSCTimetag_get)(void);
  */
 OSCServer*	OSCServer_new(OSCTimetag_get func);
 
+/**
+ * Creates a new instance of OSCServer which allocates its memory (including the copies of
+ * the stored messages) using the allocator.
+ *
+ * @param func A function which, when called, should return a current time (OSCTimetag).
+ *
+ * @param allocator A pointer to the allocator or NULL to use the default one. The allocator
+ * must stay valid until the server is deleted.
+ *
+ * @return A pointer to a newly created OSCServer or NULL if error occurred.
+ */
+OSCServer*	OSCServer_newWithAllocator(OSCTimetag_get func, OSCAllocator *allocator);
+
 /**
  * Frees the resources allocated by the OSCServer.
  *
@@ -78,17 +105,27 @@ OSCServer*	OSCServer_new(OSCTimetag_get func);
  */
 void		OSCServer_delete(OSCServer *oscServer);
 
+/**
+ * Returns the allocator of the server memory.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @return A pointer to the allocator (the default one if the server was created without it).
+ */
+OSCAllocator*	OSCServer_getAllocator(OSCServer *oscServer);
+
 
 /**
  * Adds an OSC node with name address and associates a callback message handler with it.
  *
  * @param oscServer A pointer to the OSCServer instance.
  *
- * @param address A name (address) of the node.
+ * @param address A name (address) of the node. It must start with '/'.
  *
  * @param handler A callback handler function for the node.
  *
- * @return OSC_OK if the node and handler were added successfully or error code.
+ * @return OSC_OK if the node and handler were added successfully, OSC_FORMAT_ERROR if the
+ * address is not valid or other error code.
  */
 OSCResult	OSCServer_addMessageHandler(OSCServer *oscServer, const char *address, OSCMethod handler);
 
@@ -108,23 +145,180 @@ OSCResult	OSCServer_removeMessageHandler(OSCServer *oscServer, const char *addre
 
 
 /**
- * Performs one server cycle (handles old messages, reads, parses and handles the new ones).
+ * Calls the handlers of the nodes which match the address (pattern) of the message. The
+ * handler tree is only read, so the function can be called by several threads at once
+ * (each with its own pattern) as long as no handlers are added or removed meanwhile.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param oscMessage A pointer to the message.
+ *
+ * @param pattern A pointer to the OSCPattern instance which is used to match the address.
+ *
+ * @return Non-zero if at least one handler was called.
+ */
+uint8_t		OSCServer_callHandlers(OSCServer *oscServer, OSCMessage *oscMessage, OSCPattern *pattern);
+
+/**
+ * Sets the function which is called for every due message instead of calling the handlers
+ * (e.g. to pass the messages to other threads). The message only stays valid until the
+ * function returns.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param dispatcher A dispatcher function or NULL to call the handlers directly again.
+ *
+ * @param context User data which is passed to the dispatcher.
+ */
+void		OSCServer_setDispatcher(OSCServer *oscServer, OSCDispatcher dispatcher, void *context);
+
+/**
+ * Sets the buffer which is used to receive the packets. The same buffer is reused in every
+ * server cycle. If buffer is NULL, the server allocates the buffer itself (size bytes are
+ * allocated in advance) and grows it when a larger packet arrives. Packets which do not fit
+ * into a buffer supplied by the caller are dropped. A stream which reads packets in batches
+ * can still truncate a larger packet which is queued behind other packets, the batches that
+ * follow have room for it.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param buffer A pointer to the buffer or NULL.
+ *
+ * @param size A size of the buffer in bytes.
+ *
+ * @return OSC_OK if the buffer was set or OSC_ALLOC_FAILED.
+ */
+OSCResult	OSCServer_setReceiveBuffer(OSCServer *oscServer, uint8_t *buffer, uint32_t size);
+
+/**
+ * Sets the maximum size of the packet which is accepted by the server. Larger packets are
+ * dropped.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param size A maximum packet size in bytes or 0 if there is no limit (the default is
+ * OSC_MAX_PACKET_SIZE).
+ */
+void		OSCServer_setMaxPacketSize(OSCServer *oscServer, uint32_t size);
+
+/**
+ * Returns the timetag of the earliest message which is waiting to be handled.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param timetag A pointer to the variable which receives the timetag.
+ *
+ * @return OSC_OK if there is a waiting message or OSC_ERROR if there are none.
+ */
+OSCResult	OSCServer_getNextDeadline(OSCServer *oscServer, uint64_t *timetag);
+
+/**
+ * Returns the time until the earliest stored message is due.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @return A time in microseconds (0 if a message is already due) or OSC_WAIT_FOREVER if
+ * there are no stored messages.
+ */
+uint32_t	OSCServer_getTimeout(OSCServer *oscServer);
+
+/**
+ * Parses the packet and handles its messages (the due messages are passed to the handlers
+ * and the others are stored), as if it was read in a server cycle. It is used for the packets
+ * which are not read from an OSCPacketStream (e.g. the frames decoded by OSCFrameDecoder).
+ * The function must not be called from a message handler.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param data A pointer to the packet (it must stay valid until the function returns).
+ *
+ * @param size A size of the packet in bytes.
+ *
+ * @return OSC_OK if the packet was handled, OSC_FORMAT_ERROR if the packet is malformed
+ * (none of its messages are handled) or OSC_ALLOC_FAILED.
+ */
+OSCResult	OSCServer_handlePacket(OSCServer *oscServer, uint8_t *data, uint32_t size);
+
+/**
+ * Adds a stream which is read in every server cycle (together with the stream given to
+ * OSCServer_cycle). Packets of all the streams are handled by the same handlers. The
+ * stream must stay valid until it is removed or the server is deleted.
  *
  * @param oscServer A pointer to the OSCServer instance.
  *
  * @param stream A pointer to the implemented OSCPacketStream interface.
  *
+ * @return OSC_OK if the stream was added, OSC_ERROR if it was already added or
+ * OSC_ALLOC_FAILED.
+ */
+OSCResult	OSCServer_addStream(OSCServer *oscServer, OSCPacketStream *stream);
+
+/**
+ * Removes the stream which was added by OSCServer_addStream.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param stream A pointer to the stream.
+ *
+ * @return OSC_OK if the stream was removed or OSC_ERROR if it was not found.
+ */
+OSCResult	OSCServer_removeStream(OSCServer *oscServer, OSCPacketStream *stream);
+
+/**
+ * Performs one server cycle (handles old messages, reads, parses and handles the new ones).
+ * If the stream implements readPackets, packets are read in batches of up to OSC_BATCH_SIZE
+ * and the messages of the whole batch are handled after it is parsed. When there are several
+ * streams, they take turns (one batch or one packet each) until none has packets pending.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param stream A pointer to the implemented OSCPacketStream interface or NULL to read
+ * only the streams added by OSCServer_addStream. A stream which was also added is read
+ * only once (in its turn with the added streams).
+ *
  */
 void		OSCServer_cycle(OSCServer *oscServer, OSCPacketStream *stream);
 
 /**
- * Performs server cycles forever.
+ * Performs server cycles forever, waiting between them with OSCServer_wait.
  *
  * @param oscServer A pointer to the OSCServer instance.
  *
- * @param stream A pointer to the implemented OSCPacketStream interface.
+ * @param stream A pointer to the implemented OSCPacketStream interface or NULL to read
+ * only the streams added by OSCServer_addStream.
  *
  */
 void		OSCServer_loop(OSCServer *oscServer, OSCPacketStream *stream);
 
+/**
+ * Sets the function which waits for all the streams at once (e.g. with poll on the
+ * descriptors of the streams). It is needed to sleep without any added latency when the
+ * server reads several streams.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param waiter A wait function or NULL to wait with the waitPacket functions of the streams.
+ *
+ * @param context User data which is passed to the wait function.
+ */
+void		OSCServer_setWaiter(OSCServer *oscServer, OSCWaiter waiter, void *context);
+
+/**
+ * Sleeps until a packet may be pending or the next stored message is due. The waiter set by
+ * OSCServer_setWaiter is used if there is one. Otherwise a single stream is waited for with
+ * its waitPacket function. Several streams are waited for in turns, in slices of at most
+ * OSC_WAIT_SLICE microseconds, so the packets of the other streams wait at most one slice.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @param stream A pointer to the stream given to OSCServer_cycle or NULL.
+ *
+ * @param limit A longest time to wait in microseconds (OSC_WAIT_FOREVER for no limit).
+ *
+ * @return 0 if there is nothing to wait with (no waiter is set and none of the streams has a
+ * waitPacket function), then the function returns at once. Otherwise 1: after the wait, or
+ * at once if a stored message is already due or limit is 0.
+ */
+uint8_t		OSCServer_wait(OSCServer *oscServer, OSCPacketStream *stream, uint32_t limit);
+
 #endif /* OSCSERVER_H_ */
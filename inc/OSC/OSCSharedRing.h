@@ -0,0 +1,159 @@
+/**
+ * @file	OSCSharedRing.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCSharedRing - single-producer/single-consumer packet ring in shared memory,
+ * for OSC between the processes (or threads) of one host. The ring lives in a
+ * memory block supplied by the user (e.g. mapped with shm_open and mmap by both
+ * processes) and implements OSCPacketStream, so it can be used like any other
+ * transport. There are no system calls on the way: the writer can dump a message
+ * straight into the ring (OSCSharedRing_sendMessage) and the reader can handle
+ * the packets in place (OSCSharedRing_handlePackets).
+ *
+ * Every packet is stored contiguously. A packet which does not fit (the ring is
+ * full) is dropped, like a datagram.
+ *
+ */
+
+#ifndef OSCSHAREDRING_H_
+#define OSCSHAREDRING_H_
+
+#include <stdint.h>
+#include "OSCBundle.h"
+#include "OSCMessage.h"
+#include "OSCPacketStream.h"
+#include "OSCServer.h"
+
+/**
+ * \struct OSCSharedRing is a structure which represents one end of the ring (it is local
+ * to the process) and has all private (hidden) members. OSCSharedRing should only be
+ * referenced as a pointer.
+ */
+typedef struct _OSCSharedRing OSCSharedRing;
+
+/**
+ * Returns the size of the memory block which is needed for a ring.
+ *
+ * @param capacity A number of bytes for the packets (a power of two, at least 64). Every
+ * packet takes its padded size plus 4 bytes, a packet can take up to a half of the capacity.
+ *
+ * @return A size in bytes.
+ */
+uint32_t	OSCSharedRing_getMemorySize(uint32_t capacity);
+
+/**
+ * Initializes an empty ring in the memory block. It is called once (by one of the
+ * processes) before the ring is opened.
+ *
+ * @param memory A pointer to the memory block (aligned to 64 bytes).
+ *
+ * @param size A size of the memory block, the capacity of the ring is the largest power of
+ * two which fits.
+ *
+ * @return OSC_OK or OSC_ERROR if the block is too small or not aligned.
+ */
+OSCResult	OSCSharedRing_format(void *memory, uint32_t size);
+
+/**
+ * Opens the ring which was initialized by OSCSharedRing_format. Each process opens its
+ * own end, only one process may write and only one may read.
+ *
+ * @param memory A pointer to the memory block.
+ *
+ * @return A pointer to a newly created OSCSharedRing or NULL if the memory does not contain
+ * a ring or error occurred.
+ */
+OSCSharedRing*	OSCSharedRing_open(void *memory);
+
+/**
+ * Frees the resources allocated by the OSCSharedRing (the memory block is not changed).
+ *
+ * @param ring A pointer to the OSCSharedRing instance.
+ */
+void		OSCSharedRing_close(OSCSharedRing *ring);
+
+/**
+ * Returns the OSCPacketStream interface of the ring. The packets are copied in and out of
+ * the ring, the functions below avoid the copies.
+ *
+ * @param ring A pointer to the OSCSharedRing instance.
+ *
+ * @return A pointer to the stream (valid until the ring is closed).
+ */
+OSCPacketStream*	OSCSharedRing_getStream(OSCSharedRing *ring);
+
+/**
+ * Reserves space for a packet in the ring (writer). The packet is published by
+ * OSCSharedRing_commit.
+ *
+ * @param ring A pointer to the OSCSharedRing instance.
+ *
+ * @param size A size of the packet in bytes.
+ *
+ * @return A pointer to the space or NULL if the ring is full.
+ */
+uint8_t*	OSCSharedRing_reserve(OSCSharedRing *ring, uint32_t size);
+
+/**
+ * Publishes the packet written to the reserved space (writer).
+ *
+ * @param ring A pointer to the OSCSharedRing instance.
+ *
+ * @param size A size of the packet (not larger than the reserved size).
+ */
+void		OSCSharedRing_commit(OSCSharedRing *ring, uint32_t size);
+
+/**
+ * Dumps the message straight into the ring (writer).
+ *
+ * @return OSC_OK if the message was written or OSC_ERROR if the ring is full.
+ */
+OSCResult	OSCSharedRing_sendMessage(OSCSharedRing *ring, OSCMessage *oscMessage);
+
+/**
+ * Dumps the bundle straight into the ring (writer).
+ *
+ * @return OSC_OK if the bundle was written or OSC_ERROR if the ring is full.
+ */
+OSCResult	OSCSharedRing_sendBundle(OSCSharedRing *ring, OSCBundle *oscBundle);
+
+/**
+ * Handles all the pending packets in place (reader). Each packet is passed to
+ * OSCServer_handlePacket and then released, so the function must not be called from a
+ * message handler.
+ *
+ * @param ring A pointer to the OSCSharedRing instance.
+ *
+ * @param oscServer A pointer to the OSCServer instance.
+ *
+ * @return A number of the handled packets.
+ */
+uint32_t	OSCSharedRing_handlePackets(OSCSharedRing *ring, OSCServer *oscServer);
+
+#endif /* OSCSHAREDRING_H_ */
@@ -0,0 +1,117 @@
+/**
+ * @file	OSCThreadedServer.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCThreadedServer - optional threaded mode of the OSCServer (POSIX threads, built
+ * only when OSC_THREADS is defined). A receiver thread reads and parses the packets
+ * and schedules the timetagged messages, while the due messages are passed through
+ * lock-free single-producer single-consumer rings to a pool of worker threads which
+ * call the handlers. A slow handler therefore does not stop the packets from being
+ * read. The single-threaded OSCServer_cycle works as before.
+ *
+ * Handlers are called by several threads at once, so they must be thread-safe, and
+ * handlers must not be added or removed while the threaded server is running. Due
+ * messages which have no matching handler are dropped instead of being kept.
+ *
+ */
+
+#ifndef OSCTHREADEDSERVER_H_
+#define OSCTHREADEDSERVER_H_
+
+#include "OSCServer.h"
+
+/**
+ * \struct OSCThreadedServer is a structure which represents OSCThreadedServer instance and
+ * has all private (hidden) members. OSCThreadedServer should only be referenced as a pointer.
+ */
+typedef struct _OSCThreadedServer OSCThreadedServer;
+
+/**
+ * Creates a new instance of OSCThreadedServer (the threads are not started). The memory
+ * (including the copies of the messages passed to the workers) is allocated with the
+ * allocator of the server, which is then used by several threads and has to be thread-safe.
+ *
+ * @param oscServer A pointer to the OSCServer instance which is run by the threads.
+ *
+ * @param stream A pointer to the implemented OSCPacketStream interface (it is only used
+ * by the receiver thread) or NULL to read only the streams added to the server.
+ *
+ * @param workerCount A number of the worker threads.
+ *
+ * @param queueSize A number of the messages which can wait for each worker (rounded up
+ * to a power of two).
+ *
+ * @return A pointer to a newly created OSCThreadedServer or NULL if error occurred.
+ */
+OSCThreadedServer*	OSCThreadedServer_new(OSCServer *oscServer, OSCPacketStream *stream, uint32_t workerCount, uint32_t queueSize);
+
+/**
+ * Stops the threads (if they are running) and frees the resources allocated by the
+ * OSCThreadedServer. The OSCServer is not deleted.
+ *
+ * @param threadedServer A pointer to the OSCThreadedServer instance.
+ */
+void		OSCThreadedServer_delete(OSCThreadedServer *threadedServer);
+
+/**
+ * Sets how the messages are assigned to the workers. By default they are assigned in turns,
+ * so the messages with the same address can be handled concurrently and out of order. With
+ * sharding, the address is hashed to select the worker, so all the messages with the same
+ * address are handled by one worker in the order they were received, while the messages
+ * with different addresses are still handled concurrently. The messages with address
+ * patterns are assigned by the pattern text. It must be set before the threads are started.
+ *
+ * @param threadedServer A pointer to the OSCThreadedServer instance.
+ *
+ * @param sharding Non-zero to assign the messages by the address hash.
+ *
+ * @param depth A number of the leading address segments which are hashed, or 0 to hash the
+ * whole address. E.g. with depth 1, "/mixer/1/fader" and "/mixer/2/mute" are handled by the
+ * same worker, in order.
+ */
+void		OSCThreadedServer_setSharding(OSCThreadedServer *threadedServer, uint8_t sharding, uint32_t depth);
+
+/**
+ * Starts the receiver and worker threads.
+ *
+ * @param threadedServer A pointer to the OSCThreadedServer instance.
+ *
+ * @return OSC_OK if the threads were started or OSC_ERROR.
+ */
+OSCResult	OSCThreadedServer_start(OSCThreadedServer *threadedServer);
+
+/**
+ * Stops the receiver thread and waits until the workers call the handlers for all the
+ * messages which were passed to them.
+ *
+ * @param threadedServer A pointer to the OSCThreadedServer instance.
+ */
+void		OSCThreadedServer_stop(OSCThreadedServer *threadedServer);
+
+#endif /* OSCTHREADEDSERVER_H_ */
@@ -0,0 +1,100 @@
+/**
+ * @file	OSCUDPStream.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCUDPStream - OSCPacketStream implementation for Linux UDP sockets. The stream
+ * implements waitPacket with poll() and a timerfd, so OSCServer_loop sleeps until
+ * a datagram arrives or the next stored message is due.
+ *
+ * Packets are sent to the destination set with OSCUDPStream_setDestination or,
+ * if there is none, back to the sender of the last received packet.
+ *
+ */
+
+#ifndef OSCUDPSTREAM_H_
+#define OSCUDPSTREAM_H_
+
+#include <stdint.h>
+#include "OSCPacketStream.h"
+
+/**
+ * \struct OSCUDPStream is a structure which represents a UDP socket and has all private
+ * (hidden) members. OSCUDPStream should only be referenced as a pointer.
+ */
+typedef struct _OSCUDPStream OSCUDPStream;
+
+/**
+ * Opens a UDP socket.
+ *
+ * @param port A local port the socket is bound to (0 for any).
+ *
+ * @return A pointer to a newly created OSCUDPStream or NULL if error occurred.
+ */
+OSCUDPStream*	OSCUDPStream_open(uint16_t port);
+
+/**
+ * Returns the OSCPacketStream interface of the socket, which can be passed to OSCServer
+ * or used to send messages and bundles.
+ *
+ * @param udpStream A pointer to the OSCUDPStream instance.
+ *
+ * @return A pointer to the stream (valid until the socket is closed).
+ */
+OSCPacketStream*	OSCUDPStream_getStream(OSCUDPStream *udpStream);
+
+/**
+ * Sets the address the packets are sent to.
+ *
+ * @param udpStream A pointer to the OSCUDPStream instance.
+ *
+ * @param host A numeric IPv4 address (e.g. "192.168.1.10").
+ *
+ * @param port A destination port.
+ *
+ * @return 0 if the destination was set or -1 if the address is not valid.
+ */
+int32_t		OSCUDPStream_setDestination(OSCUDPStream *udpStream, const char *host, uint16_t port);
+
+/**
+ * Returns the file descriptor of the socket (e.g. to wait for it in another event loop).
+ *
+ * @param udpStream A pointer to the OSCUDPStream instance.
+ *
+ * @return A file descriptor.
+ */
+int32_t		OSCUDPStream_getDescriptor(OSCUDPStream *udpStream);
+
+/**
+ * Closes the socket and frees the resources allocated by the OSCUDPStream.
+ *
+ * @param udpStream A pointer to the OSCUDPStream instance.
+ */
+void		OSCUDPStream_close(OSCUDPStream *udpStream);
+
+#endif /* OSCUDPSTREAM_H_ */
@@ -0,0 +1,149 @@
+/**
+ * @file	OSCWriter.h
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * OSCWriter - streaming encoder of OSC packets. Messages and (nested) bundles
+ * are written element by element straight into a caller-provided buffer, so
+ * no OSCMessage or OSCBundle objects are needed. The size of every bundle
+ * element is filled in when the element is ended.
+ *
+ * A writer is used like this:
+ *
+ * 	OSCWriter_init(&writer, buffer, sizeof(buffer));
+ * 	OSCWriter_beginBundle(&writer, OSCTimetag_immediately);
+ * 	OSCWriter_beginMessage(&writer, "/mixer/fader", "if");
+ * 	OSCWriter_append_int32(&writer, 3);
+ * 	OSCWriter_append_float(&writer, 0.5f);
+ * 	OSCWriter_endMessage(&writer);
+ * 	OSCWriter_endBundle(&writer);
+ * 	if (OSCWriter_finish(&writer, &size) == OSC_OK)
+ * 		stream->writePacket(stream->context, buffer, size);
+ *
+ * Errors are sticky: after a call fails, every following call (including
+ * OSCWriter_finish) returns the same error, so the results of the
+ * intermediate calls do not have to be checked.
+ *
+ */
+
+#ifndef OSCWRITER_H_
+#define OSCWRITER_H_
+
+#include <stdint.h>
+#include "OSCBundle.h"
+#include "OSCConfig.h"
+
+/**
+ * \struct OSCWriter describes the state of a packet being written. Members should not be
+ * accessed directly, the structure is public only so that writers can be kept on the stack.
+ */
+typedef struct _OSCWriter {
+	uint8_t *buffer;			/* Output buffer */
+	uint32_t capacity;			/* Size of the output buffer */
+	uint32_t size;				/* Number of bytes written */
+	uint32_t depth;				/* Number of open elements */
+	uint32_t sizeOffsets[OSC_WRITER_MAX_DEPTH];	/* Offsets of the size fields of the open elements */
+	char *nextType;				/* Type of the next argument of the open message (NULL outside messages) */
+	uint8_t elementCount;		/* Number of top level elements (a packet has exactly one) */
+	OSCResult result;			/* First error, OSC_OK if none */
+} OSCWriter;
+
+/**
+ * Initializes the writer to write a new packet into the buffer.
+ *
+ * @param writer A pointer to the writer to initialize.
+ *
+ * @param buffer A pointer to the output buffer.
+ *
+ * @param capacity Size of the output buffer.
+ */
+void		OSCWriter_init(OSCWriter *writer, uint8_t *buffer, uint32_t capacity);
+
+/**
+ * Begins a bundle. Bundles can be nested up to OSC_WRITER_MAX_DEPTH levels.
+ *
+ * @param writer A pointer to the writer.
+ *
+ * @param timetag A timetag of the bundle.
+ *
+ * @return OSC_OK, OSC_BUFFER_TOO_SMALL or OSC_ERROR if a bundle can not be started here.
+ */
+OSCResult	OSCWriter_beginBundle(OSCWriter *writer, uint64_t timetag);
+
+/**
+ * Ends the innermost open bundle.
+ *
+ * @return OSC_OK or OSC_ERROR if there is no open bundle.
+ */
+OSCResult	OSCWriter_endBundle(OSCWriter *writer);
+
+/**
+ * Begins a message. Its arguments must be appended in the order of the type string.
+ *
+ * @param writer A pointer to the writer.
+ *
+ * @param address An address of the message.
+ *
+ * @param types A type string of the arguments without the leading ',' (e.g. "ifsb").
+ *
+ * @return OSC_OK, OSC_BUFFER_TOO_SMALL or OSC_ERROR if a message can not be started here.
+ */
+OSCResult	OSCWriter_beginMessage(OSCWriter *writer, const char *address, const char *types);
+
+/**
+ * Appends an argument to the open message.
+ *
+ * @return OSC_OK, OSC_BUFFER_TOO_SMALL or OSC_FORMAT_ERROR if the type of the argument is
+ * not the next one of the type string.
+ */
+OSCResult	OSCWriter_append_int32(OSCWriter *writer, int32_t i);
+OSCResult	OSCWriter_append_float(OSCWriter *writer, float f);
+OSCResult	OSCWriter_append_string(OSCWriter *writer, const char *s);
+OSCResult	OSCWriter_append_blob(OSCWriter *writer, const uint8_t *blob, uint32_t size);
+
+/**
+ * Ends the open message.
+ *
+ * @return OSC_OK, OSC_FORMAT_ERROR if some of the arguments were not appended or
+ * OSC_ERROR if there is no open message.
+ */
+OSCResult	OSCWriter_endMessage(OSCWriter *writer);
+
+/**
+ * Checks that the packet is complete.
+ *
+ * @param writer A pointer to the writer.
+ *
+ * @param size A pointer to the variable which receives the size of the packet (may be NULL).
+ *
+ * @return OSC_OK if the buffer contains a complete packet, OSC_ERROR if some elements are
+ * still open or the first error which occurred while writing.
+ */
+OSCResult	OSCWriter_finish(OSCWriter *writer, uint32_t *size);
+
+#endif /* OSCWRITER_H_ */
@@ -0,0 +1,286 @@
+/**
+ * @file	OSCAllocator.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+
+#include "OSC/OSCAllocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef OSC_STATIC_ALLOCATION
+#include <MemoryManager/MemoryManager.h>
+#elif defined(OSC_THREADS)
+#include <pthread.h>
+#endif
+
+/*
+ * Private functions
+ */
+
+void* OSCAllocator_defaultAllocate(void *context, uint32_t size);
+void* OSCAllocator_defaultReallocate(void *context, void *ptr, uint32_t size);
+void OSCAllocator_defaultRelease(void *context, void *ptr);
+
+#ifdef OSC_STATIC_ALLOCATION
+
+#if OSC_STATIC_MEMORY_SIZE < 64 || (OSC_STATIC_MEMORY_SIZE & (OSC_STATIC_MEMORY_SIZE - 1)) != 0
+#error "OSC_STATIC_MEMORY_SIZE must be a power of two (at least 64)"
+#endif
+
+#define OSC_STATIC_MIN_ORDER	4		/* Smallest block is 16 bytes */
+#define OSC_STATIC_HEADER_SIZE	8
+#define OSC_STATIC_NONE			0xffffffff
+
+/*
+ * The static memory is managed as a buddy system: every block is 2^order bytes long and
+ * is split in two halves (buddies) when a smaller block is needed. Released blocks are
+ * merged with their buddies again, so the memory does not fragment into unusable pieces
+ * and the time of every operation is bounded by the number of orders.
+ */
+typedef struct {
+	uint8_t order;
+	uint8_t free;
+	uint32_t next;	/* Free blocks only: offsets of the neighbours in the free list */
+	uint32_t prev;	/* (overlaps the contents of the allocated blocks) */
+} OSCStaticBlock;
+
+static uint64_t OSCAllocator_memory[OSC_STATIC_MEMORY_SIZE / sizeof(uint64_t)];
+static uint32_t OSCAllocator_freeBlocks[32];	/* Free lists of every order */
+static uint8_t OSCAllocator_maxOrder = 0;		/* 0 until the memory is initialized */
+
+OSCStaticBlock* OSCAllocator_staticBlock(uint32_t offset);
+void OSCAllocator_staticInit(void);
+void OSCAllocator_staticPush(uint32_t offset, uint8_t order);
+void OSCAllocator_staticRemove(uint32_t offset);
+void* OSCAllocator_staticAllocate(uint32_t size);
+void OSCAllocator_staticRelease(void *ptr);
+
+/*
+ * The static memory is shared by all the threads (e.g. the receiver and the workers of
+ * OSCThreadedServer), so the blocks are taken and released under a lock
+ */
+#ifdef OSC_THREADS
+static pthread_mutex_t OSCAllocator_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define OSC_STATIC_LOCK()	pthread_mutex_lock(&OSCAllocator_mutex)
+#define OSC_STATIC_UNLOCK()	pthread_mutex_unlock(&OSCAllocator_mutex)
+#else
+#define OSC_STATIC_LOCK()
+#define OSC_STATIC_UNLOCK()
+#endif
+
+#endif /* OSC_STATIC_ALLOCATION */
+
+
+OSCAllocator OSCAllocator_default = {
+	OSCAllocator_defaultAllocate,
+	OSCAllocator_defaultReallocate,
+	OSCAllocator_defaultRelease,
+	NULL
+};
+
+#ifndef OSC_STATIC_ALLOCATION
+
+void* OSCAllocator_defaultAllocate(void *context, uint32_t size) {
+	(void)context;
+
+	return MemoryManager_malloc(size);
+}
+
+void* OSCAllocator_defaultReallocate(void *context, void *ptr, uint32_t size) {
+	(void)context;
+
+	return MemoryManager_realloc(ptr, size);
+}
+
+void OSCAllocator_defaultRelease(void *context, void *ptr) {
+	(void)context;
+
+	MemoryManager_free(ptr);
+}
+
+#else
+
+OSCStaticBlock* OSCAllocator_staticBlock(uint32_t offset) {
+	return (OSCStaticBlock*)((uint8_t*)OSCAllocator_memory + offset);
+}
+
+void OSCAllocator_staticInit(void) {
+	uint8_t order;
+	for (order=0; order<32; order++)
+		OSCAllocator_freeBlocks[order] = OSC_STATIC_NONE;
+
+	for (order=OSC_STATIC_MIN_ORDER; (1UL << order) < OSC_STATIC_MEMORY_SIZE; order++);
+
+	OSCAllocator_maxOrder = order;
+	OSCAllocator_staticPush(0, order);
+}
+
+void OSCAllocator_staticPush(uint32_t offset, uint8_t order) {
+	OSCStaticBlock *block = OSCAllocator_staticBlock(offset);
+
+	block->order = order;
+	block->free = 1;
+	block->prev = OSC_STATIC_NONE;
+	block->next = OSCAllocator_freeBlocks[order];
+
+	if (block->next != OSC_STATIC_NONE)
+		OSCAllocator_staticBlock(block->next)->prev = offset;
+
+	OSCAllocator_freeBlocks[order] = offset;
+}
+
+void OSCAllocator_staticRemove(uint32_t offset) {
+	OSCStaticBlock *block = OSCAllocator_staticBlock(offset);
+
+	if (block->prev != OSC_STATIC_NONE)
+		OSCAllocator_staticBlock(block->prev)->next = block->next;
+	else
+		OSCAllocator_freeBlocks[block->order] = block->next;
+
+	if (block->next != OSC_STATIC_NONE)
+		OSCAllocator_staticBlock(block->next)->prev = block->prev;
+
+	block->free = 0;
+}
+
+void* OSCAllocator_staticAllocate(uint32_t size) {
+	if (OSCAllocator_maxOrder == 0)
+		OSCAllocator_staticInit();
+
+	if (size > OSC_STATIC_MEMORY_SIZE - OSC_STATIC_HEADER_SIZE)
+		return NULL;
+
+	uint8_t order = OSC_STATIC_MIN_ORDER;
+	while ((1UL << order) < size + OSC_STATIC_HEADER_SIZE)
+		order++;
+
+	/*
+	 * Take the smallest free block which is large enough and split it
+	 */
+	uint8_t blockOrder = order;
+	while (blockOrder <= OSCAllocator_maxOrder && OSCAllocator_freeBlocks[blockOrder] == OSC_STATIC_NONE)
+		blockOrder++;
+
+	if (blockOrder > OSCAllocator_maxOrder)
+		return NULL;
+
+	uint32_t offset = OSCAllocator_freeBlocks[blockOrder];
+	OSCAllocator_staticRemove(offset);
+
+	while (blockOrder > order) {
+		blockOrder--;
+		OSCAllocator_staticPush(offset + (1UL << blockOrder), blockOrder);
+	}
+
+	OSCAllocator_staticBlock(offset)->order = order;
+
+	return (uint8_t*)OSCAllocator_memory + offset + OSC_STATIC_HEADER_SIZE;
+}
+
+void OSCAllocator_staticRelease(void *ptr) {
+	uint32_t offset = (uint8_t*)ptr - OSC_STATIC_HEADER_SIZE - (uint8_t*)OSCAllocator_memory;
+	uint8_t order = OSCAllocator_staticBlock(offset)->order;
+
+	/*
+	 * Merge the block with its buddy while the buddy is free and whole
+	 */
+	while (order < OSCAllocator_maxOrder) {
+		uint32_t buddyOffset = offset ^ (1UL << order);
+		OSCStaticBlock *buddy = OSCAllocator_staticBlock(buddyOffset);
+
+		if (!buddy->free || buddy->order != order)
+			break;
+
+		OSCAllocator_staticRemove(buddyOffset);
+		offset &= ~(1UL << order);
+		order++;
+	}
+
+	OSCAllocator_staticPush(offset, order);
+}
+
+void* OSCAllocator_defaultAllocate(void *context, uint32_t size) {
+	(void)context;
+
+	OSC_STATIC_LOCK();
+	void *ptr = OSCAllocator_staticAllocate(size);
+	OSC_STATIC_UNLOCK();
+
+	return ptr;
+}
+
+void* OSCAllocator_defaultReallocate(void *context, void *ptr, uint32_t size) {
+	if (ptr == NULL)
+		return OSCAllocator_defaultAllocate(context, size);
+
+	OSCStaticBlock *block = (OSCStaticBlock*)((uint8_t*)ptr - OSC_STATIC_HEADER_SIZE);
+	uint32_t capacity = (1UL << block->order) - OSC_STATIC_HEADER_SIZE;
+
+	if (size <= capacity)
+		return ptr;
+
+	OSC_STATIC_LOCK();
+	void *newPtr = OSCAllocator_staticAllocate(size);
+
+	if (newPtr != NULL) {
+		memcpy(newPtr, ptr, capacity);
+		OSCAllocator_staticRelease(ptr);
+	}
+	OSC_STATIC_UNLOCK();
+
+	return newPtr;
+}
+
+void OSCAllocator_defaultRelease(void *context, void *ptr) {
+	(void)context;
+
+	if (ptr == NULL)
+		return;
+
+	OSC_STATIC_LOCK();
+	OSCAllocator_staticRelease(ptr);
+	OSC_STATIC_UNLOCK();
+}
+
+#endif /* OSC_STATIC_ALLOCATION */
+
+void* OSCAllocator_malloc(OSCAllocator *allocator, uint32_t size) {
+	return allocator->allocate(allocator->context, size);
+}
+
+void* OSCAllocator_realloc(OSCAllocator *allocator, void *ptr, uint32_t size) {
+	return allocator->reallocate(allocator->context, ptr, size);
+}
+
+void OSCAllocator_free(OSCAllocator *allocator, void *ptr) {
+	allocator->release(allocator->context, ptr);
+}
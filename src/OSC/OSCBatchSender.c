@@ -0,0 +1,192 @@
+/**
+ * @file	OSCBatchSender.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+#include "OSC/OSCBatchSender.h"
+
+#include <string.h>
+
+#include "OSC/OSCBundle.h"
+#include "OSC/OSCConfig.h"
+#include "OSC/OSCMisc.h"
+
+#define OSC_BATCH_HEADER_SIZE	(8 + 8)			/* "#bundle" + timetag */
+#define OSC_BATCH_MIN_MTU		(OSC_BATCH_HEADER_SIZE + 4 + 8)	/* Room for the smallest message ("/" without arguments) */
+
+typedef struct _OSCBatchSender {
+	OSCPacketStream *stream;	/* Stream the packets are written to */
+	OSCTimetag_get getTime;		/* Current time function (NULL if there is no latency limit) */
+	uint64_t latency;			/* Time a message can wait (timetag difference) */
+	uint64_t deadline;			/* Time the queued messages are due */
+	uint8_t *buffer;			/* Bundle being filled (mtu bytes) */
+	uint32_t mtu;				/* Size of the buffer */
+	uint32_t size;				/* Used size of the buffer */
+	uint32_t messageCount;		/* Number of queued messages */
+	OSCAllocator *allocator;	/* Allocator of the sender and its buffer */
+} OSCBatchSender;
+
+/*
+ * Private functions
+ */
+
+OSCResult OSCBatchSender_append(OSCBatchSender *sender, OSCMessage *oscMessage);
+
+
+OSCBatchSender* OSCBatchSender_new(OSCPacketStream *stream, uint32_t mtu, OSCTimetag_get func) {
+	return OSCBatchSender_newWithAllocator(stream, mtu, func, NULL);
+}
+
+OSCBatchSender* OSCBatchSender_newWithAllocator(OSCPacketStream *stream, uint32_t mtu, OSCTimetag_get func, OSCAllocator *allocator) {
+	if (mtu < OSC_BATCH_MIN_MTU)
+		return NULL;
+
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	OSCBatchSender *sender = (OSCBatchSender*)OSCAllocator_malloc(allocator, sizeof(OSCBatchSender));
+
+	if (sender == NULL)
+		return NULL;
+
+	sender->buffer = (uint8_t*)OSCAllocator_malloc(allocator, mtu);
+
+	if (sender->buffer == NULL) {
+		OSCAllocator_free(allocator, sender);
+		return NULL;
+	}
+
+	sender->allocator = allocator;
+	sender->stream = stream;
+	sender->getTime = func;
+	sender->mtu = mtu;
+	sender->deadline = 0;
+	sender->messageCount = 0;
+	sender->size = OSC_BATCH_HEADER_SIZE;
+
+	/* The bundle header never changes */
+	uint8_t *ptr = sender->buffer;
+	memcpy(ptr, "#bundle", 8);	// including null
+	memset(ptr + 8, 0, 8);
+	ptr[15] = OSCTimetag_immediately;
+
+	OSCBatchSender_setLatency(sender, OSC_BATCH_LATENCY);
+
+	return sender;
+}
+
+void OSCBatchSender_delete(OSCBatchSender *sender) {
+	OSCAllocator_free(sender->allocator, sender->buffer);
+	OSCAllocator_free(sender->allocator, sender);
+}
+
+void OSCBatchSender_setLatency(OSCBatchSender *sender, uint32_t latency) {
+	sender->latency = ((uint64_t)latency << 32) / 1000000;	// microseconds to 32.32 fixed point seconds
+}
+
+/*
+ * Encodes the message (with its size) after the queued ones, returns OSC_BUFFER_TOO_SMALL if
+ * it does not fit
+ */
+OSCResult OSCBatchSender_append(OSCBatchSender *sender, OSCMessage *oscMessage) {
+	uint32_t size;
+
+	if (sender->mtu - sender->size < 4)
+		return OSC_BUFFER_TOO_SMALL;
+
+	OSCResult res = OSCMessage_encode(oscMessage, sender->buffer + sender->size + 4, sender->mtu - sender->size - 4, &size);
+
+	if (res != OSC_OK)
+		return res;
+
+	uint8_t *ptr = sender->buffer + sender->size;
+	*ptr++ = (size >> 24);
+	*ptr++ = (size >> 16);
+	*ptr++ = (size >> 8);
+	*ptr++ = (size & 0xFF);
+
+	sender->size += 4 + size;
+
+	return OSC_OK;
+}
+
+OSCResult OSCBatchSender_sendMessage(OSCBatchSender *sender, OSCMessage *oscMessage) {
+	if (OSCBatchSender_append(sender, oscMessage) != OSC_OK) {
+		OSCBatchSender_flush(sender);
+
+		if (OSCBatchSender_append(sender, oscMessage) != OSC_OK)
+			return OSCMessage_sendMessage(oscMessage, sender->stream);	// larger than the MTU
+	}
+
+	if (sender->getTime == NULL) {
+		sender->messageCount++;
+		return OSC_OK;
+	}
+
+	uint64_t now = sender->getTime();
+
+	if (sender->messageCount++ == 0)
+		sender->deadline = now + sender->latency;
+
+	if (now == OSCTimetag_immediately || now >= sender->deadline)
+		OSCBatchSender_flush(sender);
+
+	return OSC_OK;
+}
+
+void OSCBatchSender_flush(OSCBatchSender *sender) {
+	if (sender->messageCount == 0)
+		return;
+
+	if (sender->messageCount == 1)
+		sender->stream->writePacket(sender->stream->context, sender->buffer + OSC_BATCH_HEADER_SIZE + 4, sender->size - OSC_BATCH_HEADER_SIZE - 4);
+	else
+		sender->stream->writePacket(sender->stream->context, sender->buffer, sender->size);
+
+	sender->messageCount = 0;
+	sender->size = OSC_BATCH_HEADER_SIZE;
+}
+
+void OSCBatchSender_poll(OSCBatchSender *sender) {
+	if (OSCBatchSender_getTimeout(sender) == 0)
+		OSCBatchSender_flush(sender);
+}
+
+uint32_t OSCBatchSender_getTimeout(OSCBatchSender *sender) {
+	if (sender->messageCount == 0 || sender->getTime == NULL)
+		return OSC_WAIT_FOREVER;
+
+	uint64_t now = sender->getTime();
+
+	if (now == OSCTimetag_immediately || sender->deadline <= now)
+		return 0;
+
+	return OSCMisc_getTimeout(sender->deadline - now);
+}
@@ -32,11 +32,11 @@
 
 #include "OSC/OSCBundle.h"
 
-#include <MemoryManager/MemoryManager.h>
-
 #include <stdlib.h>
 #include <string.h>
 
+#define OSC_BUNDLE_PREALLOC_SIZE	8
+
 typedef struct _OSCElement {
 	enum { OSC_BUNDLE, OSC_MESSAGE } type;
 
@@ -50,41 +50,88 @@ typedef struct _OSCElement {
 typedef struct _OSCBundle {
 	OSCTimetag	timetag;
 	uint32_t	elementCount;
-	OSCElement** elements;
+	uint32_t	elementCapacity;
+	OSCElement*	elements;		/* Elements stored inline, the array grows geometrically */
+	uint32_t	size;			/* Encoded size (kept up to date as elements are added) */
+	uint32_t*	refCount;		/* Number of clones sharing the element array and its elements (NULL if not shared) */
+	OSCAllocator *allocator;	/* Allocator of the bundle and its elements */
 } OSCBundle;
 
 
+/*
+ * Private functions
+ */
+
+OSCResult OSCBundle_reserveElements(OSCBundle *oscBundle, uint32_t count);
+OSCResult OSCBundle_addElement(OSCBundle *oscBundle, OSCElement *oscElement);
+uint8_t* OSCBundle_write(OSCBundle *bundle, uint8_t *ptr);
+OSCBundle* OSCBundle_share(OSCBundle *oscBundle);
+OSCResult OSCBundle_unshare(OSCBundle *oscBundle);
+void OSCBundle_releaseElements(OSCBundle *oscBundle);
+
+
 OSCBundle* OSCBundle_new(void) {
-	OSCBundle *bundle = (OSCBundle*) MemoryManager_malloc(sizeof(OSCBundle));
+	return OSCBundle_newWithAllocator(NULL);
+}
+
+OSCBundle* OSCBundle_newWithAllocator(OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	OSCBundle *bundle = (OSCBundle*) OSCAllocator_malloc(allocator, sizeof(OSCBundle));
 
 	if (bundle == NULL)
 		return NULL;
 
+	bundle->allocator = allocator;
+
 	bundle->timetag.raw = OSCTimetag_immediately;
 
 	bundle->elementCount = 0;
+	bundle->elementCapacity = 0;
 	bundle->elements = NULL;
+	bundle->size = 8 + 8; // "#bundle" + timetag
+	bundle->refCount = NULL;
 
 	return bundle;
 }
 
 OSCBundle*	OSCBundle_clone(OSCBundle *oscBundle) {
-	OSCBundle *bundle = (OSCBundle*) MemoryManager_malloc(sizeof(OSCBundle));
+	return OSCBundle_cloneWithAllocator(oscBundle, oscBundle->allocator);
+}
+
+/*
+ * A clone using the same allocator shares the elements of the source bundle until either of
+ * them is modified, other clones are deep copies.
+ */
+OSCBundle*	OSCBundle_cloneWithAllocator(OSCBundle *oscBundle, OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	if (allocator == oscBundle->allocator)
+		return OSCBundle_share(oscBundle);
+
+	OSCBundle *bundle = OSCBundle_newWithAllocator(allocator);
 
 	if (bundle == NULL )
 		return NULL;
 
 	bundle->timetag.raw = oscBundle->timetag.raw;
 
+	if (OSCBundle_reserveElements(bundle, oscBundle->elementCount) != OSC_OK) {
+		OSCBundle_delete(bundle);
+		return NULL;
+	}
+
 	uint32_t i;
 	for (i = 0; i < oscBundle->elementCount; i++) {
 		OSCResult res = OSC_ERROR;
-		switch (oscBundle->elements[i]->type) {
+		switch (oscBundle->elements[i].type) {
 		case OSC_BUNDLE:
-			res = OSCBundle_addBundle(bundle, oscBundle->elements[i]->contents.bundle);
+			res = OSCBundle_addBundle(bundle, oscBundle->elements[i].contents.bundle);
 			break;
 		case OSC_MESSAGE:
-			res = OSCBundle_addMessage(bundle, oscBundle->elements[i]->contents.message);
+			res = OSCBundle_addMessage(bundle, oscBundle->elements[i].contents.message);
 			break;
 		}
 
@@ -98,86 +145,232 @@ OSCBundle*	OSCBundle_clone(OSCBundle *oscBundle) {
 }
 
 void OSCBundle_delete(OSCBundle *oscBundle) {
+	OSCBundle_releaseElements(oscBundle);
+
+	OSCAllocator_free(oscBundle->allocator, oscBundle);
+}
+
+/*
+ * Functions for sharing the elements between clones (copy-on-write)
+ */
+
+OSCBundle* OSCBundle_share(OSCBundle *oscBundle) {
+	if (oscBundle->refCount == NULL) {
+		oscBundle->refCount = (uint32_t*)OSCAllocator_malloc(oscBundle->allocator, sizeof(uint32_t));
+
+		if (oscBundle->refCount == NULL)
+			return NULL;
+
+		*oscBundle->refCount = 1;
+	}
+
+	OSCBundle *bundle = (OSCBundle*)OSCAllocator_malloc(oscBundle->allocator, sizeof(OSCBundle));
+
+	if (bundle == NULL)
+		return NULL;
+
+	*bundle = *oscBundle;
+	__atomic_add_fetch(oscBundle->refCount, 1, __ATOMIC_RELAXED);
+
+	return bundle;
+}
+
+/*
+ * Gives the bundle its own element array before it is modified. The elements are cloned,
+ * which shares their storage, so this does not copy any message contents.
+ */
+OSCResult OSCBundle_unshare(OSCBundle *oscBundle) {
+	if (oscBundle->refCount == NULL)
+		return OSC_OK;
+
+	OSCAllocator *allocator = oscBundle->allocator;
+
+	if (__atomic_load_n(oscBundle->refCount, __ATOMIC_ACQUIRE) == 1) {	// all the other clones are deleted
+		OSCAllocator_free(allocator, oscBundle->refCount);
+		oscBundle->refCount = NULL;
+		return OSC_OK;
+	}
+
+	OSCElement *elements = NULL;
+
+	if (oscBundle->elementCapacity > 0) {
+		elements = (OSCElement*)OSCAllocator_malloc(allocator, sizeof(OSCElement)*oscBundle->elementCapacity);
+
+		if (elements == NULL)
+			return OSC_ALLOC_FAILED;
+	}
+
 	uint32_t i;
-	for (i=0; i<oscBundle->elementCount; i++) {
-		MemoryManager_free(oscBundle->elements[i]->contents.ptr);
-		MemoryManager_free(oscBundle->elements[i]);
+	for (i = 0; i < oscBundle->elementCount; i++) {
+		elements[i].type = oscBundle->elements[i].type;
+
+		switch (elements[i].type) {
+		case OSC_BUNDLE:
+			elements[i].contents.bundle = OSCBundle_clone(oscBundle->elements[i].contents.bundle);
+			break;
+		case OSC_MESSAGE:
+			elements[i].contents.message = OSCMessage_clone(oscBundle->elements[i].contents.message);
+			break;
+		}
+
+		if (elements[i].contents.ptr == NULL)
+			break;
+	}
+
+	if (i < oscBundle->elementCount) {
+		while (i-- > 0) {
+			if (elements[i].type == OSC_BUNDLE)
+				OSCBundle_delete(elements[i].contents.bundle);
+			else
+				OSCMessage_delete(elements[i].contents.message);
+		}
+		OSCAllocator_free(allocator, elements);
+		return OSC_ALLOC_FAILED;
+	}
+
+	OSCBundle_releaseElements(oscBundle);
+
+	oscBundle->elements = elements;
+	oscBundle->refCount = NULL;
+
+	return OSC_OK;
+}
+
+/*
+ * Deletes the elements unless they are still shared with other clones
+ */
+void OSCBundle_releaseElements(OSCBundle *oscBundle) {
+	if (oscBundle->refCount != NULL) {
+		if (__atomic_sub_fetch(oscBundle->refCount, 1, __ATOMIC_ACQ_REL) > 0)
+			return;
+
+		OSCAllocator_free(oscBundle->allocator, oscBundle->refCount);
 	}
-	MemoryManager_free(oscBundle->elements);
 
-	MemoryManager_free(oscBundle);
+	uint32_t i;
+	for (i=0; i<oscBundle->elementCount; i++) {
+		switch (oscBundle->elements[i].type) {
+		case OSC_BUNDLE:
+			OSCBundle_delete(oscBundle->elements[i].contents.bundle);
+			break;
+		case OSC_MESSAGE:
+			OSCMessage_delete(oscBundle->elements[i].contents.message);
+			break;
+		}
+	}
+	OSCAllocator_free(oscBundle->allocator, oscBundle->elements);
 }
 
 void OSCBundle_setTimetag(OSCBundle *oscBundle, uint64_t timetag) {
 	oscBundle->timetag.raw = timetag;
 }
 
-OSCResult OSCBundle_addElement(OSCBundle *oscBundle, OSCElement *oscElement) {
-	OSCElement **elements = (OSCElement**)MemoryManager_realloc(oscBundle->elements, sizeof(OSCElement*)*(oscBundle->elementCount+1));
+/*
+ * Makes room for at least count elements. The array grows geometrically, so adding N
+ * elements one by one takes O(log N) reallocations.
+ */
+OSCResult OSCBundle_reserveElements(OSCBundle *oscBundle, uint32_t count) {
+	if (OSCBundle_unshare(oscBundle) != OSC_OK)
+		return OSC_ALLOC_FAILED;
 
-	if (elements == NULL)
+	if (oscBundle->elementCapacity >= count)
+		return OSC_OK;
+
+	uint32_t newCapacity = (oscBundle->elementCapacity > 0) ? oscBundle->elementCapacity : OSC_BUNDLE_PREALLOC_SIZE;
+	while (newCapacity < count)
+		newCapacity <<= 1;
+
+	OSCElement *newElements = (OSCElement*)OSCAllocator_realloc(oscBundle->allocator, oscBundle->elements, sizeof(OSCElement)*newCapacity);
+
+	if (newElements == NULL)
 		return OSC_ALLOC_FAILED;
 
-	oscBundle->elements = elements;
+	oscBundle->elements = newElements;
+	oscBundle->elementCapacity = newCapacity;
 
-	oscBundle->elements[oscBundle->elementCount] = oscElement;
+	return OSC_OK;
+}
+
+/*
+ * Stores the element (its contents are owned by the bundle from now on)
+ */
+OSCResult OSCBundle_addElement(OSCBundle *oscBundle, OSCElement *oscElement) {
+	OSCResult res = OSCBundle_reserveElements(oscBundle, oscBundle->elementCount + 1);
+
+	if (res != OSC_OK)
+		return res;
+
+	oscBundle->elements[oscBundle->elementCount] = *oscElement;
 	oscBundle->elementCount++;
 
+	switch (oscElement->type) {
+		case OSC_BUNDLE:
+			oscBundle->size += 4 + OSCBundle_getPaddedLength(oscElement->contents.bundle);
+			break;
+		case OSC_MESSAGE:
+			oscBundle->size += 4 + OSCMessage_getPaddedLength(oscElement->contents.message);
+			break;
+	}
+
 	return OSC_OK;
 }
 
 OSCResult OSCBundle_addMessage(OSCBundle *oscBundle, OSCMessage *oscMessage) {
-	OSCMessage *msg = OSCMessage_clone(oscMessage);
+	OSCResult res = OSCBundle_reserveElements(oscBundle, oscBundle->elementCount + 1);
 
-	if (msg == NULL)
-		return OSC_ALLOC_FAILED;
+	if (res != OSC_OK)
+		return res;
 
-	OSCElement *element = (OSCElement*)MemoryManager_malloc(sizeof(OSCElement));
+	OSCMessage *msg = OSCMessage_cloneWithAllocator(oscMessage, oscBundle->allocator);
 
-	if (element == NULL) {
-		MemoryManager_free(msg);
+	if (msg == NULL)
 		return OSC_ALLOC_FAILED;
-	}
-
-	element->type = OSC_MESSAGE;
-	element->contents.message = msg;
 
-	OSCResult res = OSCBundle_addElement(oscBundle, element);
+	res = OSCBundle_adoptMessage(oscBundle, msg);
 
-	if (res != OSC_OK) {
-		MemoryManager_free(msg);
-		MemoryManager_free(element);
-		return res;
-	}
+	if (res != OSC_OK)
+		OSCMessage_delete(msg);
 
-	return OSC_OK;
+	return res;
 }
 
 OSCResult OSCBundle_addBundle(OSCBundle *oscBundle, OSCBundle *oscBundleIn) {
-	OSCBundle *bundle = OSCBundle_clone(oscBundleIn);
+	OSCResult res = OSCBundle_reserveElements(oscBundle, oscBundle->elementCount + 1);
 
-	if (bundle == NULL )
-		return OSC_ALLOC_FAILED;
+	if (res != OSC_OK)
+		return res;
 
-	OSCElement *element = (OSCElement*) MemoryManager_malloc(sizeof(OSCElement));
+	OSCBundle *bundle = OSCBundle_cloneWithAllocator(oscBundleIn, oscBundle->allocator);
 
-	if (element == NULL ) {
-		MemoryManager_free(bundle);
+	if (bundle == NULL)
 		return OSC_ALLOC_FAILED;
-	}
 
-	element->type = OSC_BUNDLE;
-	element->contents.bundle = bundle;
+	/*
+	 * A bundle added to itself is shared by the clone, so adopting has to unshare it again
+	 * and can still fail
+	 */
+	res = OSCBundle_adoptBundle(oscBundle, bundle);
 
-	OSCResult res = OSCBundle_addElement(oscBundle, element);
+	if (res != OSC_OK)
+		OSCBundle_delete(bundle);
 
-	if (res != OSC_OK) {
-		MemoryManager_free(bundle);
-		MemoryManager_free(element);
-		return res;
-	}
+	return res;
+}
 
-	return OSC_OK;
+OSCResult OSCBundle_adoptMessage(OSCBundle *oscBundle, OSCMessage *oscMessage) {
+	OSCElement element;
+	element.type = OSC_MESSAGE;
+	element.contents.message = oscMessage;
+
+	return OSCBundle_addElement(oscBundle, &element);
+}
+
+OSCResult OSCBundle_adoptBundle(OSCBundle *oscBundle, OSCBundle *oscBundleIn) {
+	OSCElement element;
+	element.type = OSC_BUNDLE;
+	element.contents.bundle = oscBundleIn;
+
+	return OSCBundle_addElement(oscBundle, &element);
 }
 
 
@@ -189,42 +382,45 @@ OSCResult OSCBundle_sendBundle(OSCBundle *bundle, OSCPacketStream *stream) {
 
 	uint32_t size = OSCBundle_getPaddedLength(bundle);
 
-	uint8_t *data = (uint8_t*)MemoryManager_malloc(size);
+	uint8_t *data = (uint8_t*)OSCAllocator_malloc(bundle->allocator, size);
 
 	if (data == NULL)
 		return OSC_ALLOC_FAILED;
 
-	OSCBundle_dump(bundle, data);
+	OSCBundle_write(bundle, data);
 
-	stream->writePacket(data, size);
-	MemoryManager_free(data);
+	stream->writePacket(stream->context, data, size);
+	OSCAllocator_free(bundle->allocator, data);
 
 	return OSC_OK;
 }
 
 uint32_t OSCBundle_getPaddedLength(OSCBundle *bundle) {
-	uint32_t size = 8 + 8; // "#bundle" + timetag
-
-	uint32_t i;
-	for (i = 0; i < bundle->elementCount; i++) {
-		switch (bundle->elements[i]->type) {
-			case OSC_BUNDLE:
-				size += 4 + OSCBundle_getPaddedLength(bundle->elements[i]->contents.bundle);
-				break;
-			case OSC_MESSAGE:
-				size += 4 + OSCMessage_getPaddedLength(bundle->elements[i]->contents.message);
-				break;
-		}
-	}
-
-	return size;
+	return bundle->size;
 }
 
 void OSCBundle_dump(OSCBundle *bundle, uint8_t *data) {
-	memset(data, 0, OSCBundle_getPaddedLength(bundle)); // clear the memory (zerofill takes care of padding and null chars)
+	OSCBundle_write(bundle, data);
+}
+
+OSCResult OSCBundle_encode(OSCBundle *bundle, uint8_t *buffer, uint32_t capacity, uint32_t *size) {
+	if (size != NULL)
+		*size = bundle->size;
 
-	uint8_t *ptr = data;
-	memcpy(ptr, "#bundle", 7);
+	if (bundle->size > capacity)
+		return OSC_BUFFER_TOO_SMALL;
+
+	OSCBundle_write(bundle, buffer);
+
+	return OSC_OK;
+}
+
+/*
+ * Writes the bundle in a single pass (the element sizes are already known) and returns the
+ * position after it
+ */
+uint8_t* OSCBundle_write(OSCBundle *bundle, uint8_t *ptr) {
+	memcpy(ptr, "#bundle", 8);	// including null
 	ptr += 8;
 
 	uint64_t timetag = bundle->timetag.raw;
@@ -239,25 +435,28 @@ void OSCBundle_dump(OSCBundle *bundle, uint8_t *data) {
 
 	uint32_t i, size;
 	for (i = 0; i < bundle->elementCount; i++) {
-		switch (bundle->elements[i]->type) {
+		switch (bundle->elements[i].type) {
 		case OSC_BUNDLE:
-			size = OSCBundle_getPaddedLength(bundle->elements[i]->contents.bundle);
+			size = OSCBundle_getPaddedLength(bundle->elements[i].contents.bundle);
 			*ptr++ = (size >> 24);
 			*ptr++ = (size >> 16);
 			*ptr++ = (size >> 8);
 			*ptr++ = (size & 0xFF);
 
-			OSCBundle_dump(bundle->elements[i]->contents.bundle, ptr);
+			ptr = OSCBundle_write(bundle->elements[i].contents.bundle, ptr);
 			break;
 		case OSC_MESSAGE:
-			size = OSCMessage_getPaddedLength(bundle->elements[i]->contents.message);
+			size = OSCMessage_getPaddedLength(bundle->elements[i].contents.message);
 			*ptr++ = (size >> 24);
 			*ptr++ = (size >> 16);
 			*ptr++ = (size >> 8);
 			*ptr++ = (size & 0xFF);
 
-			OSCMessage_dump(bundle->elements[i]->contents.message, ptr);
+			OSCMessage_encode(bundle->elements[i].contents.message, ptr, size, NULL);
+			ptr += size;
 			break;
 		}
 	}
+
+	return ptr;
 }
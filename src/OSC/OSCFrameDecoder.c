@@ -0,0 +1,270 @@
+/**
+ * @file	OSCFrameDecoder.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+
+#include "OSC/OSCFrameDecoder.h"
+
+#include <string.h>
+
+#define OSC_FRAME_PREALLOC_SIZE	64
+
+#define SLIP_END		0xC0
+#define SLIP_ESC		0xDB
+#define SLIP_ESC_END	0xDC
+#define SLIP_ESC_ESC	0xDD
+
+struct _OSCFrameDecoder {
+	OSCServer *server;
+	OSCFraming framing;
+	uint32_t maxFrameSize;	/* Larger frames are skipped, 0 if there is no limit */
+
+	uint8_t *buffer;		/* Frame which is split between the chunks */
+	uint32_t bufferSize;
+	uint32_t frameSize;		/* Number of bytes of the frame in the buffer */
+	uint8_t dropping;		/* Set while the rest of a skipped frame is read */
+
+	uint8_t escaped;		/* SLIP: the last byte was SLIP_ESC */
+
+	uint32_t header;		/* Length: the frame size which is being read */
+	uint8_t headerBytes;	/* Length: number of the size bytes read (4 when the frame is read) */
+	uint32_t remaining;		/* Length: number of the frame bytes not received yet */
+
+	OSCAllocator *allocator;
+};
+
+/*
+ * Private functions
+ */
+
+OSCResult OSCFrameDecoder_append(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size);
+void OSCFrameDecoder_endFrame(OSCFrameDecoder *decoder);
+OSCResult OSCFrameDecoder_decodeSLIP(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size);
+OSCResult OSCFrameDecoder_decodeLength(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size);
+
+
+OSCFrameDecoder* OSCFrameDecoder_new(OSCServer *oscServer, OSCFraming framing) {
+	return OSCFrameDecoder_newWithAllocator(oscServer, framing, NULL);
+}
+
+OSCFrameDecoder* OSCFrameDecoder_newWithAllocator(OSCServer *oscServer, OSCFraming framing, OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	OSCFrameDecoder *decoder = (OSCFrameDecoder*)OSCAllocator_malloc(allocator, sizeof(OSCFrameDecoder));
+
+	if (decoder == NULL)
+		return NULL;
+
+	decoder->allocator = allocator;
+	decoder->server = oscServer;
+	decoder->framing = framing;
+	decoder->maxFrameSize = OSC_MAX_PACKET_SIZE;
+	decoder->buffer = NULL;
+	decoder->bufferSize = 0;
+
+	OSCFrameDecoder_reset(decoder);
+
+	return decoder;
+}
+
+void OSCFrameDecoder_delete(OSCFrameDecoder *decoder) {
+	OSCAllocator_free(decoder->allocator, decoder->buffer);
+	OSCAllocator_free(decoder->allocator, decoder);
+}
+
+void OSCFrameDecoder_setMaxFrameSize(OSCFrameDecoder *decoder, uint32_t size) {
+	decoder->maxFrameSize = size;
+}
+
+void OSCFrameDecoder_reset(OSCFrameDecoder *decoder) {
+	decoder->frameSize = 0;
+	decoder->dropping = 0;
+	decoder->escaped = 0;
+	decoder->header = 0;
+	decoder->headerBytes = 0;
+	decoder->remaining = 0;
+}
+
+OSCResult OSCFrameDecoder_decode(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size) {
+	if (decoder->framing == OSC_FRAMING_SLIP)
+		return OSCFrameDecoder_decodeSLIP(decoder, data, size);
+
+	return OSCFrameDecoder_decodeLength(decoder, data, size);
+}
+
+/*
+ * Adds the data to the buffered frame. If the frame gets too large (or the buffer cannot
+ * be grown) the rest of it is skipped.
+ */
+OSCResult OSCFrameDecoder_append(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size) {
+	if (decoder->dropping)
+		return OSC_OK;
+
+	if (size > 0xffffffff - decoder->frameSize
+			|| (decoder->maxFrameSize > 0 && decoder->frameSize + size > decoder->maxFrameSize)) {
+		decoder->dropping = 1;
+		return OSC_OK;
+	}
+
+	uint32_t frameSize = decoder->frameSize + size;
+
+	if (frameSize > decoder->bufferSize) {
+		uint32_t newSize = (decoder->bufferSize > 0) ? decoder->bufferSize : OSC_FRAME_PREALLOC_SIZE;
+
+		while (newSize < frameSize && newSize <= 0x7fffffff)
+			newSize *= 2;
+		if (newSize < frameSize)
+			newSize = frameSize;
+
+		uint8_t *newBuffer = (uint8_t*)OSCAllocator_realloc(decoder->allocator, decoder->buffer, newSize);
+
+		if (newBuffer == NULL) {
+			decoder->dropping = 1;
+			return OSC_ALLOC_FAILED;
+		}
+
+		decoder->buffer = newBuffer;
+		decoder->bufferSize = newSize;
+	}
+
+	memcpy(decoder->buffer + decoder->frameSize, data, size);
+	decoder->frameSize = frameSize;
+
+	return OSC_OK;
+}
+
+/*
+ * Handles the buffered frame (unless it was skipped) and starts a new one
+ */
+void OSCFrameDecoder_endFrame(OSCFrameDecoder *decoder) {
+	if (!decoder->dropping && decoder->frameSize > 0)
+		OSCServer_handlePacket(decoder->server, decoder->buffer, decoder->frameSize);
+
+	decoder->frameSize = 0;
+	decoder->dropping = 0;
+}
+
+OSCResult OSCFrameDecoder_decodeSLIP(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size) {
+	OSCResult result = OSC_OK;
+	uint8_t *end = data + size;
+
+	while (data < end) {
+		/*
+		 * Find the run of the bytes which need no unescaping
+		 */
+		uint8_t *run = data;
+
+		if (!decoder->escaped) {
+			while (data < end && *data != SLIP_END && *data != SLIP_ESC)
+				data++;
+		}
+
+		if (data > run) {
+			if (data < end && *data == SLIP_END && decoder->frameSize == 0 && !decoder->dropping) {
+				/*
+				 * The whole frame is in the chunk, it is handled in place
+				 */
+				if (decoder->maxFrameSize == 0 || (uint32_t)(data - run) <= decoder->maxFrameSize)
+					OSCServer_handlePacket(decoder->server, run, data - run);
+				data++;
+			} else if (OSCFrameDecoder_append(decoder, run, data - run) != OSC_OK) {
+				result = OSC_ALLOC_FAILED;
+			}
+			continue;
+		}
+
+		uint8_t byte = *data++;
+
+		if (decoder->escaped) {
+			decoder->escaped = 0;
+
+			if (byte == SLIP_ESC_END)
+				byte = SLIP_END;
+			else if (byte == SLIP_ESC_ESC)
+				byte = SLIP_ESC;	// other bytes are kept as they are (RFC 1055)
+
+			if (OSCFrameDecoder_append(decoder, &byte, 1) != OSC_OK)
+				result = OSC_ALLOC_FAILED;
+		} else if (byte == SLIP_ESC) {
+			decoder->escaped = 1;
+		} else {	// SLIP_END (empty frames between two END bytes are ignored)
+			OSCFrameDecoder_endFrame(decoder);
+		}
+	}
+
+	return result;
+}
+
+OSCResult OSCFrameDecoder_decodeLength(OSCFrameDecoder *decoder, uint8_t *data, uint32_t size) {
+	OSCResult result = OSC_OK;
+	uint8_t *end = data + size;
+
+	while (data < end) {
+		if (decoder->headerBytes < 4) {
+			decoder->header = (decoder->header << 8) | *data++;
+			decoder->headerBytes++;
+
+			if (decoder->headerBytes == 4) {
+				decoder->remaining = decoder->header;
+				decoder->dropping = (decoder->maxFrameSize > 0 && decoder->header > decoder->maxFrameSize);
+			}
+		} else {
+			uint32_t available = end - data;
+
+			if (decoder->frameSize == 0 && !decoder->dropping && available >= decoder->remaining) {
+				/*
+				 * The whole frame is in the chunk, it is handled in place
+				 */
+				if (decoder->remaining > 0)
+					OSCServer_handlePacket(decoder->server, data, decoder->remaining);
+				data += decoder->remaining;
+				decoder->remaining = 0;
+			} else {
+				uint32_t length = (available < decoder->remaining) ? available : decoder->remaining;
+
+				if (OSCFrameDecoder_append(decoder, data, length) != OSC_OK)
+					result = OSC_ALLOC_FAILED;
+
+				data += length;
+				decoder->remaining -= length;
+			}
+		}
+
+		if (decoder->headerBytes == 4 && decoder->remaining == 0) {
+			OSCFrameDecoder_endFrame(decoder);
+			decoder->header = 0;
+			decoder->headerBytes = 0;
+		}
+	}
+
+	return result;
+}
@@ -35,8 +35,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <MemoryManager/MemoryManager.h>
-
+#include "OSC/OSCMessageView.h"
 #include "OSC/OSCMisc.h"
 
 
@@ -47,26 +46,42 @@ typedef struct _OSCArgument {
 	union {
 		int32_t i;	// integer
 		float f;	// float
-		char* s;	// string
-		uint8_t* b;	// blob
+		uint32_t offset;	// string or blob (offset of the contents in the payload buffer)
 	} data;
 } OSCArgument;
 
 
 typedef struct _OSCMessage {
 	char *address;			/* String containing message address */
-	char *types;			/* Argument type string descriptor */
 	uint32_t addressSize;	/* Size (length) of the allocated *address array */
-	uint32_t typesSize;		/* Size (length) of the allocated *types array */
+	uint32_t addressLength;	/* Length of the address string */
 	uint32_t argumentCount;	/* Number of arguments */
-	OSCArgument **arguments;	/* Argument pointer array */
+	uint32_t argumentCapacity;	/* Number of argument slots in the argument slab */
+	OSCArgument *arguments;	/* Argument slab: argumentCapacity arguments followed by argumentCapacity type characters */
+	char *types;			/* Argument type string descriptor (points into the argument slab) */
+	uint8_t *payload;		/* Contents of string and blob arguments */
+	uint32_t payloadSize;	/* Used size of the *payload array */
+	uint32_t payloadCapacity;	/* Size (length) of the allocated *payload array */
+	uint32_t argumentsSize;	/* Encoded size of the arguments (kept up to date as they are added) */
+	OSCMessageView *view;	/* View the message is read from instead of its own storage (NULL if none) */
+	uint32_t *refCount;		/* Number of clones sharing the address, argument and payload storage (NULL if not shared) */
+	OSCAllocator *allocator;	/* Allocator of all the memory owned by the message */
 } OSCMessage;
 
 /*
  * Private functions
  */
 
-OSCResult OSCMessage_addArgument(OSCMessage *oscMessage, char type, OSCArgument *oscArgument);
+OSCResult OSCMessage_reserveArguments(OSCMessage *oscMessage, uint32_t count);
+OSCResult OSCMessage_reservePayload(OSCMessage *oscMessage, uint32_t size);
+OSCResult OSCMessage_addArgument(OSCMessage *oscMessage, char type, uint32_t size, int32_t data);
+OSCResult OSCMessage_addArgument_data(OSCMessage *oscMessage, char type, const void *data, uint32_t size);
+OSCResult OSCMessage_copyView(OSCMessage *oscMessage, OSCMessageView *view);
+OSCResult OSCMessage_detachView(OSCMessage *oscMessage);
+OSCMessage* OSCMessage_share(OSCMessage *oscMessage);
+OSCResult OSCMessage_unshare(OSCMessage *oscMessage);
+void OSCMessage_releaseStorage(OSCMessage *oscMessage);
+uint8_t* OSCMessage_writePadded(uint8_t *ptr, const void *data, uint32_t size);
 
 
 /*
@@ -74,226 +89,399 @@ OSCResult OSCMessage_addArgument(OSCMessage *oscMessage, char type, OSCArgument
  */
 
 OSCMessage* OSCMessage_new(void) {
-	OSCMessage *msg = (OSCMessage*)MemoryManager_malloc(sizeof(OSCMessage));
+	return OSCMessage_newWithAllocator(NULL);
+}
+
+OSCMessage* OSCMessage_newWithAllocator(OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	OSCMessage *msg = (OSCMessage*)OSCAllocator_malloc(allocator, sizeof(OSCMessage));
 
 	if (msg == NULL)
 		return NULL;
 
+	msg->allocator = allocator;
+
 	msg->address = NULL;
 	msg->addressSize = 0;
-
-	msg->types = NULL;
-	msg->typesSize = 0;
+	msg->addressLength = 0;
 
 	msg->arguments = NULL;
+	msg->types = NULL;
 	msg->argumentCount = 0;
+	msg->argumentCapacity = 0;
+
+	msg->payload = NULL;
+	msg->payloadSize = 0;
+	msg->payloadCapacity = 0;
+	msg->argumentsSize = 0;
 
-	OSCMessage_setAddress(msg, "/");
+	msg->view = NULL;
+	msg->refCount = NULL;
+
+	if (OSCMessage_setAddress(msg, "/") != OSC_OK) {
+		OSCMessage_delete(msg);
+		return NULL;
+	}
 
 	return msg;
 }
 
 OSCMessage* OSCMessage_clone(OSCMessage *oscMessage) {
-	OSCMessage *msg = (OSCMessage*) MemoryManager_malloc(sizeof(OSCMessage));
+	return OSCMessage_cloneWithAllocator(oscMessage, oscMessage->allocator);
+}
+
+/*
+ * A clone using the same allocator shares the storage of the source message until either of
+ * them is modified, other clones are deep copies.
+ */
+OSCMessage* OSCMessage_cloneWithAllocator(OSCMessage *oscMessage, OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	if (allocator == oscMessage->allocator && oscMessage->view == NULL)
+		return OSCMessage_share(oscMessage);
+
+	OSCMessage *msg = OSCMessage_newWithAllocator(allocator);
 
 	if (msg == NULL)
 		return NULL;
 
-	OSCResult res = OSCMessage_setAddress(msg, oscMessage->address);
-
-	if (res != OSC_OK) {
+	if (OSCMessage_copy(msg, oscMessage) != OSC_OK) {
 		OSCMessage_delete(msg);
 		return NULL;
 	}
 
-	uint32_t i;
-	for (i=0; i<oscMessage->argumentCount; i++) {
-		OSCArgument* argument = (OSCArgument*) MemoryManager_malloc(sizeof(OSCArgument));
+	return msg;
+}
 
-		if (argument == NULL ) {
-			OSCMessage_delete(msg);
-			return NULL ;
-		}
+/*
+ * Replaces the contents of the message with a copy of the source message. Memory which is
+ * already allocated by the message is reused.
+ */
+OSCResult OSCMessage_copy(OSCMessage *oscMessage, OSCMessage *source) {
+	if (source->view != NULL)
+		return OSCMessage_setFromView(oscMessage, source->view);
 
-		argument->size = oscMessage->arguments[i]->size;
-		argument->data.i = oscMessage->arguments[i]->data.i;
+	OSCMessage_setView(oscMessage, NULL);
 
-		res = OSCMessage_addArgument(msg, oscMessage->types[i], argument);
+	if (OSCMessage_setAddress(oscMessage, source->address) != OSC_OK
+			|| OSCMessage_reserveArguments(oscMessage, source->argumentCount) != OSC_OK
+			|| OSCMessage_reservePayload(oscMessage, source->payloadSize) != OSC_OK)
+		return OSC_ALLOC_FAILED;
 
-		if (res != OSC_OK) {
-			OSCMessage_delete(msg);
-			return NULL ;
-		}
+	if (source->argumentCount > 0) {
+		memcpy(oscMessage->arguments, source->arguments, sizeof(OSCArgument)*source->argumentCount);
+		memcpy(oscMessage->types, source->types, source->argumentCount);
+	}
+	oscMessage->argumentCount = source->argumentCount;
+
+	if (source->payloadSize > 0)
+		memcpy(oscMessage->payload, source->payload, source->payloadSize);
+	oscMessage->payloadSize = source->payloadSize;
+	oscMessage->argumentsSize = source->argumentsSize;
+
+	return OSC_OK;
+}
+
+OSCMessage* OSCMessage_newFromView(OSCMessageView *view) {
+	return OSCMessage_newFromViewWithAllocator(view, NULL);
+}
+
+OSCMessage* OSCMessage_newFromViewWithAllocator(OSCMessageView *view, OSCAllocator *allocator) {
+	OSCMessage *msg = OSCMessage_newWithAllocator(allocator);
+
+	if (msg == NULL)
+		return NULL;
+
+	if (OSCMessage_copyView(msg, view) != OSC_OK) {
+		OSCMessage_delete(msg);
+		return NULL;
 	}
 
 	return msg;
 }
 
 void OSCMessage_delete(OSCMessage *oscMessage) {
-	MemoryManager_free(oscMessage->address);
+	OSCMessage_releaseStorage(oscMessage);
 
-	uint32_t i;
-	for (i=0; i<oscMessage->argumentCount; i++) {
-		if (oscMessage->types[i] == 'b' || oscMessage->types[i] == 's') {
-			MemoryManager_free(oscMessage->arguments[i]->data.b);
-		}
-		MemoryManager_free(oscMessage->arguments[i]);
+	OSCAllocator_free(oscMessage->allocator, oscMessage);
+}
+
+/*
+ * Functions for sharing the storage between clones (copy-on-write)
+ */
+
+OSCMessage* OSCMessage_share(OSCMessage *oscMessage) {
+	if (oscMessage->refCount == NULL) {
+		oscMessage->refCount = (uint32_t*)OSCAllocator_malloc(oscMessage->allocator, sizeof(uint32_t));
+
+		if (oscMessage->refCount == NULL)
+			return NULL;
+
+		*oscMessage->refCount = 1;
+	}
+
+	OSCMessage *msg = (OSCMessage*)OSCAllocator_malloc(oscMessage->allocator, sizeof(OSCMessage));
+
+	if (msg == NULL)
+		return NULL;
+
+	*msg = *oscMessage;
+	__atomic_add_fetch(oscMessage->refCount, 1, __ATOMIC_RELAXED);
+
+	return msg;
+}
+
+/*
+ * Gives the message its own copy of the storage before it is modified. The capacities are
+ * kept, so the copy can be reused the same way as the original storage.
+ */
+OSCResult OSCMessage_unshare(OSCMessage *oscMessage) {
+	if (oscMessage->refCount == NULL)
+		return OSC_OK;
+
+	OSCAllocator *allocator = oscMessage->allocator;
+
+	if (__atomic_load_n(oscMessage->refCount, __ATOMIC_ACQUIRE) == 1) {	// all the other clones are deleted
+		OSCAllocator_free(allocator, oscMessage->refCount);
+		oscMessage->refCount = NULL;
+		return OSC_OK;
+	}
+
+	char *address = (char*)OSCAllocator_malloc(allocator, oscMessage->addressSize);
+	OSCArgument *arguments = NULL;
+	uint8_t *payload = NULL;
+
+	if (oscMessage->argumentCapacity > 0)
+		arguments = (OSCArgument*)OSCAllocator_malloc(allocator, (sizeof(OSCArgument) + 1)*oscMessage->argumentCapacity);
+	if (oscMessage->payloadCapacity > 0)
+		payload = (uint8_t*)OSCAllocator_malloc(allocator, oscMessage->payloadCapacity);
+
+	if (address == NULL || (arguments == NULL && oscMessage->argumentCapacity > 0)
+			|| (payload == NULL && oscMessage->payloadCapacity > 0)) {
+		OSCAllocator_free(allocator, address);
+		OSCAllocator_free(allocator, arguments);
+		OSCAllocator_free(allocator, payload);
+		return OSC_ALLOC_FAILED;
 	}
-	MemoryManager_free(oscMessage->arguments);
-	MemoryManager_free(oscMessage->types);
 
-	MemoryManager_free(oscMessage);
+	memcpy(address, oscMessage->address, oscMessage->addressLength + 1);
+
+	char *types = (char*)(arguments + oscMessage->argumentCapacity);
+	if (oscMessage->argumentCount > 0) {
+		memcpy(arguments, oscMessage->arguments, sizeof(OSCArgument)*oscMessage->argumentCount);
+		memcpy(types, oscMessage->types, oscMessage->argumentCount);
+	}
+
+	if (oscMessage->payloadSize > 0)
+		memcpy(payload, oscMessage->payload, oscMessage->payloadSize);
+
+	OSCMessage_releaseStorage(oscMessage);
+
+	oscMessage->address = address;
+	oscMessage->arguments = arguments;
+	oscMessage->types = types;
+	oscMessage->payload = payload;
+	oscMessage->refCount = NULL;
+
+	return OSC_OK;
+}
+
+/*
+ * Frees the storage unless it is still shared with other clones
+ */
+void OSCMessage_releaseStorage(OSCMessage *oscMessage) {
+	OSCAllocator *allocator = oscMessage->allocator;
+
+	if (oscMessage->refCount != NULL) {
+		if (__atomic_sub_fetch(oscMessage->refCount, 1, __ATOMIC_ACQ_REL) > 0)
+			return;
+
+		OSCAllocator_free(allocator, oscMessage->refCount);
+	}
+
+	OSCAllocator_free(allocator, oscMessage->address);
+	OSCAllocator_free(allocator, oscMessage->arguments);
+	OSCAllocator_free(allocator, oscMessage->payload);
 }
 
 OSCResult OSCMessage_setAddress(OSCMessage *oscMessage, const char* str) {
+	if (oscMessage->view != NULL && OSCMessage_detachView(oscMessage) != OSC_OK)
+		return OSC_ALLOC_FAILED;
+
+	if (OSCMessage_unshare(oscMessage) != OSC_OK)
+		return OSC_ALLOC_FAILED;
+
 	uint32_t len = strlen(str); /* Address length */
 
 	if (oscMessage->addressSize < len+1) {
 		uint32_t newSize = OSC_PREALLOC_SIZE*(len/OSC_PREALLOC_SIZE + 1); // TODO: make it faster (replace div and mult with bit shifts)
-		char* newAddress = (char*)MemoryManager_malloc(newSize);
+		char* newAddress = (char*)OSCAllocator_malloc(oscMessage->allocator, newSize);
 
 		if (newAddress == NULL) return OSC_ALLOC_FAILED;
 
-		MemoryManager_free(oscMessage->address);
+		memcpy(newAddress, str, len+1);	// str may point into the old address
+		OSCAllocator_free(oscMessage->allocator, oscMessage->address);
 		oscMessage->address = newAddress;
 		oscMessage->addressSize = newSize;
+	} else {
+		memmove(oscMessage->address, str, len+1);
 	}
 
-	strcpy(oscMessage->address, str);
-	oscMessage->address[len] = '\0';
+	oscMessage->addressLength = len;
 
 	return OSC_OK;
 }
 
-char* OSCMessage_getAddress(OSCMessage *oscMessage) {
+const char* OSCMessage_getAddress(OSCMessage *oscMessage) {
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getAddress(oscMessage->view);
+
 	return oscMessage->address;
 }
 
 
-OSCResult OSCMessage_addArgument(OSCMessage *oscMessage, char type, OSCArgument *oscArgument) {
-	if (oscMessage->typesSize < oscMessage->argumentCount + 1) {
-		uint32_t newSize = oscMessage->typesSize + OSC_PREALLOC_SIZE;
-		char* newTypes = (char*)MemoryManager_realloc(oscMessage->types, newSize);
+/*
+ * Makes room for at least count arguments. The argument slab grows geometrically, so adding
+ * N arguments one by one takes O(log N) reallocations.
+ */
+OSCResult OSCMessage_reserveArguments(OSCMessage *oscMessage, uint32_t count) {
+	if (oscMessage->argumentCapacity >= count)
+		return OSC_OK;
 
-		if (newTypes == NULL) return OSC_ALLOC_FAILED;
+	uint32_t newCapacity = (oscMessage->argumentCapacity > 0) ? oscMessage->argumentCapacity : OSC_PREALLOC_SIZE;
+	while (newCapacity < count)
+		newCapacity <<= 1;
 
-		oscMessage->typesSize = newSize;
-		oscMessage->types = newTypes;
-	}
+#if OSC_MAX_ARGUMENTS > 0
+	if (count > OSC_MAX_ARGUMENTS)
+		return OSC_ALLOC_FAILED;
+	if (newCapacity > OSC_MAX_ARGUMENTS)
+		newCapacity = OSC_MAX_ARGUMENTS;
+#endif
 
-	OSCArgument** newArguments = (OSCArgument**)MemoryManager_realloc(oscMessage->arguments, sizeof(OSCArgument*)*(oscMessage->argumentCount+1));
+	OSCArgument *newArguments = (OSCArgument*)OSCAllocator_realloc(oscMessage->allocator, oscMessage->arguments, (sizeof(OSCArgument) + 1)*newCapacity);
 
 	if (newArguments == NULL) return OSC_ALLOC_FAILED;
 
-	oscMessage->arguments = newArguments;
-
-	/* Done alloc, now set things up */
+	/* Type characters are stored right after the argument array, so move them past the new slots */
+	char *newTypes = (char*)(newArguments + newCapacity);
+	memmove(newTypes, (char*)(newArguments + oscMessage->argumentCapacity), oscMessage->argumentCount);
 
-	oscMessage->types[oscMessage->argumentCount] = type;
-	oscMessage->arguments[oscMessage->argumentCount] = oscArgument;
-	oscMessage->argumentCount++;
+	oscMessage->arguments = newArguments;
+	oscMessage->types = newTypes;
+	oscMessage->argumentCapacity = newCapacity;
 
 	return OSC_OK;
 }
 
+OSCResult OSCMessage_reservePayload(OSCMessage *oscMessage, uint32_t size) {
+	if (oscMessage->payloadCapacity >= size)
+		return OSC_OK;
 
-OSCResult OSCMessage_addArgument_int32(OSCMessage *oscMessage, int32_t i) {
-	OSCArgument* oscArgument = (OSCArgument*)MemoryManager_malloc(sizeof(OSCArgument));
-
-	if (oscArgument == NULL) return OSC_ALLOC_FAILED;
+	uint32_t newCapacity = (oscMessage->payloadCapacity > 0) ? oscMessage->payloadCapacity : OSC_PREALLOC_SIZE*4;
+	while (newCapacity < size)
+		newCapacity <<= 1;
 
-	oscArgument->size = 4;
-	oscArgument->data.i = i;
+	uint8_t *newPayload = (uint8_t*)OSCAllocator_realloc(oscMessage->allocator, oscMessage->payload, newCapacity);
 
-	OSCResult res = OSCMessage_addArgument(oscMessage, 'i', oscArgument);
+	if (newPayload == NULL) return OSC_ALLOC_FAILED;
 
-	if (res != OSC_OK)
-		MemoryManager_free(oscArgument);
+	oscMessage->payload = newPayload;
+	oscMessage->payloadCapacity = newCapacity;
 
-	return res;
+	return OSC_OK;
 }
 
-OSCResult OSCMessage_addArgument_float(OSCMessage *oscMessage, float f) {
-	OSCArgument* oscArgument = (OSCArgument*)MemoryManager_malloc(sizeof(OSCArgument));
+OSCResult OSCMessage_addArgument(OSCMessage *oscMessage, char type, uint32_t size, int32_t data) {
+	if (oscMessage->view != NULL && OSCMessage_detachView(oscMessage) != OSC_OK)
+		return OSC_ALLOC_FAILED;
 
-	if (oscArgument == NULL)
+	if (OSCMessage_unshare(oscMessage) != OSC_OK)
 		return OSC_ALLOC_FAILED;
 
-	oscArgument->size = 4;
-	oscArgument->data.f = f;
+	OSCResult res = OSCMessage_reserveArguments(oscMessage, oscMessage->argumentCount + 1);
 
-	OSCResult res = OSCMessage_addArgument(oscMessage, 'f', oscArgument);
+	if (res != OSC_OK) return res;
 
-	if (res != OSC_OK)
-		MemoryManager_free(oscArgument);
+	/* Done alloc, now set things up */
 
-	return res;
-}
+	oscMessage->types[oscMessage->argumentCount] = type;
+	oscMessage->arguments[oscMessage->argumentCount].size = size;
+	oscMessage->arguments[oscMessage->argumentCount].data.i = data;
+	oscMessage->argumentCount++;
+	oscMessage->argumentsSize += ((type == 'b') ? 4 : 0) + OSCMisc_getPaddedLength(size);	// blobs are prefixed with their size
 
-OSCResult OSCMessage_addArgument_string(OSCMessage *oscMessage, const char* s) {
-	/* Allocate OSCArgument */
-	OSCArgument* oscArgument = (OSCArgument*)MemoryManager_malloc(sizeof(OSCArgument));
+	return OSC_OK;
+}
 
-	if (oscArgument == NULL)
+OSCResult OSCMessage_addArgument_data(OSCMessage *oscMessage, char type, const void *data, uint32_t size) {
+	if (oscMessage->view != NULL && OSCMessage_detachView(oscMessage) != OSC_OK)
 		return OSC_ALLOC_FAILED;
 
-	/* Allocate string */
-	uint32_t len = strlen(s);
-	char* stringCopy = (char*)MemoryManager_malloc(len+1);
+	/*
+	 * The data may be an argument of this message (e.g. a string returned by
+	 * OSCMessage_getArgument_string), which moves if the payload is reallocated
+	 */
+	uint8_t *payload = oscMessage->payload;
+	uint8_t inPayload = (payload != NULL && (const uint8_t*)data >= payload && (const uint8_t*)data < payload + oscMessage->payloadSize);
+	uint32_t dataOffset = inPayload ? (uint32_t)((const uint8_t*)data - payload) : 0;
 
-	if (stringCopy == NULL) {
-		MemoryManager_free(oscArgument);
+	if (OSCMessage_unshare(oscMessage) != OSC_OK)
 		return OSC_ALLOC_FAILED;
-	}
-
-	/* Do the rest */
 
-	oscArgument->size = len+1;
-	oscArgument->data.s = stringCopy;
-	strcpy(oscArgument->data.s, s);
+	/* Reserve both the argument slot and payload space before modifying anything */
+	OSCResult res = OSCMessage_reserveArguments(oscMessage, oscMessage->argumentCount + 1);
 
-	OSCResult res = OSCMessage_addArgument(oscMessage, 's', oscArgument);
+	if (res != OSC_OK) return res;
 
-	if (res != OSC_OK)
-		MemoryManager_free(oscArgument);
+	res = OSCMessage_reservePayload(oscMessage, oscMessage->payloadSize + size);
 
-	return res;
-}
+	if (res != OSC_OK) return res;
 
-OSCResult OSCMessage_addArgument_blob(OSCMessage *oscMessage, uint8_t *blob, int32_t size) {
-	/* Allocate OSCArgument */
-	OSCArgument *oscArgument = (OSCArgument*)MemoryManager_malloc(sizeof(OSCArgument));
+	if (inPayload)
+		data = oscMessage->payload + dataOffset;
 
-	if (oscArgument == NULL)
-		return OSC_ALLOC_FAILED;
+	uint32_t offset = oscMessage->payloadSize;
+	memcpy(oscMessage->payload + offset, data, size);
+	oscMessage->payloadSize += size;
 
-	/* Allocate blob memory */
-	uint8_t *newBlob = (uint8_t*)MemoryManager_malloc(size);
+	return OSCMessage_addArgument(oscMessage, type, size, (int32_t)offset);
+}
 
-	if (newBlob == NULL) {
-		MemoryManager_free(oscArgument);
-		return OSC_ALLOC_FAILED;
-	}
 
-	/* Do the rest */
+OSCResult OSCMessage_addArgument_int32(OSCMessage *oscMessage, int32_t i) {
+	return OSCMessage_addArgument(oscMessage, 'i', 4, i);
+}
 
-	oscArgument->size = size;
-	oscArgument->data.b = newBlob;
-	memcpy(oscArgument->data.b, blob, size);
+OSCResult OSCMessage_addArgument_float(OSCMessage *oscMessage, float f) {
+	union { float f; int32_t i; } tmp;
+	tmp.f = f;
 
-	OSCResult res = OSCMessage_addArgument(oscMessage, 'b', oscArgument);
+	return OSCMessage_addArgument(oscMessage, 'f', 4, tmp.i);
+}
 
-	if (res != OSC_OK)
-		MemoryManager_free(oscArgument);
+OSCResult OSCMessage_addArgument_string(OSCMessage *oscMessage, const char* s) {
+	return OSCMessage_addArgument_data(oscMessage, 's', s, strlen(s)+1); // including the null character
+}
 
-	return res;
+OSCResult OSCMessage_addArgument_blob(OSCMessage *oscMessage, const uint8_t *blob, int32_t size) {
+	return OSCMessage_addArgument_data(oscMessage, 'b', blob, size);
 }
 
 uint32_t OSCMessage_getArgumentCount(OSCMessage *oscMessage) {
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getArgumentCount(oscMessage->view);
+
 	return oscMessage->argumentCount;
 }
 
 char OSCMessage_getArgumentType(OSCMessage *oscMessage, uint32_t position) {
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getArgumentType(oscMessage->view, position);
+
 	if (position < oscMessage->argumentCount)
 		return oscMessage->types[position];
 
@@ -301,39 +489,120 @@ char OSCMessage_getArgumentType(OSCMessage *oscMessage, uint32_t position) {
 }
 
 int32_t OSCMessage_getArgument_int32 (OSCMessage *oscMessage, uint32_t position) {
-	if (position < oscMessage->argumentCount) {
-		return oscMessage->arguments[position]->data.i;
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getArgument_int32(oscMessage->view, position);
+
+	if (position < oscMessage->argumentCount && (oscMessage->types[position] == 'i' || oscMessage->types[position] == 'f')) {
+		return oscMessage->arguments[position].data.i;
 	}
 
 	return 0;
 }
 
 float OSCMessage_getArgument_float(OSCMessage *oscMessage, uint32_t position) {
-	if (position < oscMessage->argumentCount) {
-		return oscMessage->arguments[position]->data.f;
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getArgument_float(oscMessage->view, position);
+
+	if (position < oscMessage->argumentCount && (oscMessage->types[position] == 'i' || oscMessage->types[position] == 'f')) {
+		return oscMessage->arguments[position].data.f;
 	}
 
 	return 0.0f;
 }
 
-char* OSCMessage_getArgument_string(OSCMessage *oscMessage, uint32_t position) {
-	if (position < oscMessage->argumentCount) {
-		return oscMessage->arguments[position]->data.s;
+const char* OSCMessage_getArgument_string(OSCMessage *oscMessage, uint32_t position) {
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getArgument_string(oscMessage->view, position);
+
+	if (position < oscMessage->argumentCount && oscMessage->types[position] == 's') {
+		return (const char*)(oscMessage->payload + oscMessage->arguments[position].data.offset);
 	}
 
 	return NULL;
 }
 
-uint8_t* OSCMessage_getArgument_blob(OSCMessage *oscMessage, uint32_t position, uint32_t *size) {
-	if (position < oscMessage->argumentCount) {
-		*size = oscMessage->arguments[position]->size;
-		return oscMessage->arguments[position]->data.b;
+const uint8_t* OSCMessage_getArgument_blob(OSCMessage *oscMessage, uint32_t position, uint32_t *size) {
+	if (oscMessage->view != NULL)
+		return OSCMessageView_getArgument_blob(oscMessage->view, position, size);
+
+	if (position < oscMessage->argumentCount && (oscMessage->types[position] == 'b' || oscMessage->types[position] == 's')) {
+		*size = oscMessage->arguments[position].size;
+		return oscMessage->payload + oscMessage->arguments[position].data.offset;
 	}
 
 	*size = 0;
 	return NULL;
 }
 
+/*
+ * Functions for reading messages from views
+ */
+
+/*
+ * Makes the message a read-only wrapper of the view without copying anything. The view
+ * must stay valid until the message is deleted or set to another view. Modifying the
+ * message copies the contents of the view first.
+ */
+void OSCMessage_setView(OSCMessage *oscMessage, OSCMessageView *view) {
+	oscMessage->argumentCount = 0;
+	oscMessage->payloadSize = 0;
+	oscMessage->argumentsSize = 0;
+	oscMessage->view = view;
+}
+
+/*
+ * Replaces the contents of the message with a copy of the view. Memory which is already
+ * allocated by the message is reused.
+ */
+OSCResult OSCMessage_setFromView(OSCMessage *oscMessage, OSCMessageView *view) {
+	OSCMessage_setView(oscMessage, NULL);
+
+	return OSCMessage_copyView(oscMessage, view);
+}
+
+OSCResult OSCMessage_copyView(OSCMessage *oscMessage, OSCMessageView *view) {
+	uint32_t count = OSCMessageView_getArgumentCount(view);
+
+	OSCResult res = OSCMessage_setAddress(oscMessage, OSCMessageView_getAddress(view));
+
+	/* Encoded message size is the upper bound of the payload size */
+	if (res == OSC_OK)
+		res = OSCMessage_reserveArguments(oscMessage, count);
+	if (res == OSC_OK)
+		res = OSCMessage_reservePayload(oscMessage, oscMessage->payloadSize + view->size);
+
+	uint32_t i;
+	for (i = 0; i < count && res == OSC_OK; i++) {
+		switch (OSCMessageView_getArgumentType(view, i)) {
+			case 'i':
+				res = OSCMessage_addArgument_int32(oscMessage, OSCMessageView_getArgument_int32(view, i));
+				break;
+			case 'f':
+				res = OSCMessage_addArgument_float(oscMessage, OSCMessageView_getArgument_float(view, i));
+				break;
+			case 's':
+				res = OSCMessage_addArgument_string(oscMessage, OSCMessageView_getArgument_string(view, i));
+				break;
+			case 'b': {
+				uint32_t size;
+				uint8_t *blob = OSCMessageView_getArgument_blob(view, i, &size);
+				res = OSCMessage_addArgument_blob(oscMessage, blob, size);
+				break;
+			}
+		}
+	}
+
+	return res;
+}
+
+OSCResult OSCMessage_detachView(OSCMessage *oscMessage) {
+	OSCMessageView *view = oscMessage->view;
+
+	oscMessage->view = NULL;
+
+	return OSCMessage_copyView(oscMessage, view);
+}
+
 /*
  * Functions for message sending
  */
@@ -341,51 +610,78 @@ uint8_t* OSCMessage_getArgument_blob(OSCMessage *oscMessage, uint32_t position,
 OSCResult OSCMessage_sendMessage(OSCMessage *oscMessage, OSCPacketStream *stream) {
 	uint32_t size = OSCMessage_getPaddedLength(oscMessage);
 
-	uint8_t *data = (uint8_t*)MemoryManager_malloc(size);
+	uint8_t *data = (uint8_t*)OSCAllocator_malloc(oscMessage->allocator, size);
 
 	if (data == NULL)
 		return OSC_ALLOC_FAILED;
 
-	OSCMessage_dump(oscMessage, data);
+	OSCMessage_encode(oscMessage, data, size, &size);
 
-	stream->writePacket(data, size);
-	MemoryManager_free(data);
+	stream->writePacket(stream->context, data, size);
+	OSCAllocator_free(oscMessage->allocator, data);
 
 	return OSC_OK;
 }
 
 uint32_t OSCMessage_getPaddedLength(OSCMessage *oscMessage) {
-	uint32_t size = OSCMisc_getPaddedLength(strlen(oscMessage->address) + 1) 	// address size (including null)
-					+ OSCMisc_getPaddedLength(oscMessage->argumentCount + 2);	// type descriptor (including , and null)
+	if (oscMessage->view != NULL)
+		return oscMessage->view->size;
 
-	uint32_t i;
-	for (i = 0; i < oscMessage->argumentCount; i++) {
-		if (oscMessage->types[i] == 'b')
-			size += 4;
+	return OSCMisc_getPaddedLength(oscMessage->addressLength + 1) 	// address size (including null)
+			+ OSCMisc_getPaddedLength(oscMessage->argumentCount + 2)	// type descriptor (including , and null)
+			+ oscMessage->argumentsSize;
+}
 
-		size += OSCMisc_getPaddedLength(oscMessage->arguments[i]->size);
-	}
+void OSCMessage_dump(OSCMessage *oscMessage, uint8_t *data) {
+	OSCMessage_encode(oscMessage, data, 0xffffffff, NULL);
+}
 
-	return size;
+/*
+ * Copies the data and zeroes the padding after it, returns the position after the padding
+ */
+uint8_t* OSCMessage_writePadded(uint8_t *ptr, const void *data, uint32_t size) {
+	uint32_t paddedSize = OSCMisc_getPaddedLength(size);
+
+	if (size > 0)
+		memcpy(ptr, data, size);
+	memset(ptr + size, 0, paddedSize - size);
+
+	return ptr + paddedSize;
 }
 
-void OSCMessage_dump(OSCMessage *oscMessage, uint8_t *data) {
-	memset(data, 0, OSCMessage_getPaddedLength(oscMessage)); // clear the memory (zerofill takes care of padding and null chars)
+OSCResult OSCMessage_encode(OSCMessage *oscMessage, uint8_t *buffer, uint32_t capacity, uint32_t *size) {
+	uint32_t length = OSCMessage_getPaddedLength(oscMessage);
+
+	if (size != NULL)
+		*size = length;
 
-	uint8_t *ptr = data;
-	memcpy(ptr, oscMessage->address, strlen(oscMessage->address));
-	ptr += OSCMisc_getPaddedLength(strlen(oscMessage->address) + 1);// address size (including null)
+	if (length > capacity)
+		return OSC_BUFFER_TOO_SMALL;
 
+	if (oscMessage->view != NULL) {
+		memcpy(buffer, oscMessage->view->data, oscMessage->view->size);
+		return OSC_OK;
+	}
+
+	/*
+	 * Only the padding is cleared, every other byte is written once
+	 */
+	uint8_t *ptr = buffer;
+	ptr = OSCMessage_writePadded(ptr, oscMessage->address, oscMessage->addressLength + 1);	// address (including null)
+
+	uint32_t typesSize = OSCMisc_getPaddedLength(oscMessage->argumentCount + 2);	// type descriptor (including , and null)
 	*ptr = ',';
-	memcpy(ptr + 1, oscMessage->types, oscMessage->argumentCount);
-	ptr += OSCMisc_getPaddedLength(oscMessage->argumentCount + 2);// type descriptor (including , and null)
+	if (oscMessage->argumentCount > 0)
+		memcpy(ptr + 1, oscMessage->types, oscMessage->argumentCount);
+	memset(ptr + 1 + oscMessage->argumentCount, 0, typesSize - oscMessage->argumentCount - 1);
+	ptr += typesSize;
 
 	uint32_t i, tmp;
 	for (i = 0; i < oscMessage->argumentCount; i++) {
 		switch (oscMessage->types[i]) {
 			case 'i':
 			case 'f': { // let's assume int and float has the same endianess
-				tmp = oscMessage->arguments[i]->data.i;
+				tmp = oscMessage->arguments[i].data.i;
 				*ptr++ = (tmp >> 24);
 				*ptr++ = (tmp >> 16);
 				*ptr++ = (tmp >> 8);
@@ -393,17 +689,19 @@ void OSCMessage_dump(OSCMessage *oscMessage, uint8_t *data) {
 				break;
 			}
 			case 'b': {
-				tmp = oscMessage->arguments[i]->size;
+				tmp = oscMessage->arguments[i].size;
 				*ptr++ = (tmp >> 24);
 				*ptr++ = (tmp >> 16);
 				*ptr++ = (tmp >> 8);
 				*ptr++ = (tmp & 0xFF);
 			}
+				/* fall through */
 			case 's': {
-				memcpy(ptr, oscMessage->arguments[i]->data.s, oscMessage->arguments[i]->size);
-				ptr += OSCMisc_getPaddedLength(oscMessage->arguments[i]->size);
+				ptr = OSCMessage_writePadded(ptr, oscMessage->payload + oscMessage->arguments[i].data.offset, oscMessage->arguments[i].size);
 				break;
 			}
 		}
 	}
+
+	return OSC_OK;
 }
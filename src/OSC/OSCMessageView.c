@@ -0,0 +1,229 @@
+/**
+ * @file	OSCMessageView.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+#include "OSC/OSCMessageView.h"
+
+#include <string.h>
+
+#include "OSC/OSCMisc.h"
+
+/*
+ * Private functions
+ */
+
+uint32_t	OSCMessageView_getStringSize(uint8_t *ptr, uint8_t *end);
+uint32_t	OSCMessageView_getArgumentSize(char type, uint8_t *ptr, uint8_t *end);
+uint8_t*	OSCMessageView_seek(OSCMessageView *view, uint32_t position);
+
+static inline uint32_t OSCMessageView_read32(uint8_t *ptr) {
+	return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) | ((uint32_t)ptr[2] << 8) | ((uint32_t)ptr[3]);
+}
+
+/*
+ * Returns the padded size of the string (including null) or 0 if it does not fit before end
+ */
+uint32_t OSCMessageView_getStringSize(uint8_t *ptr, uint8_t *end) {
+	uint8_t *null = (uint8_t*)memchr(ptr, '\0', end - ptr);
+
+	if (null == NULL)
+		return 0;
+
+	uint32_t size = OSCMisc_getPaddedLength(null - ptr + 1);
+
+	if (size > (uint32_t)(end - ptr))
+		return 0;
+
+	return size;
+}
+
+/*
+ * Returns the encoded size of the argument or 0 if it is malformed
+ */
+uint32_t OSCMessageView_getArgumentSize(char type, uint8_t *ptr, uint8_t *end) {
+	uint32_t available = end - ptr;
+
+	switch (type) {
+		case 'i':
+		case 'f':
+			return (available >= 4) ? 4 : 0;
+		case 's':
+			return OSCMessageView_getStringSize(ptr, end);
+		case 'b': {
+			if (available < 4)
+				return 0;
+
+			uint32_t size = OSCMessageView_read32(ptr);
+			if (size > available - 4 || OSCMisc_getPaddedLength(size) > available - 4)
+				return 0;
+
+			return 4 + OSCMisc_getPaddedLength(size);
+		}
+	}
+
+	return 0;
+}
+
+OSCResult OSCMessageView_init(OSCMessageView *view, uint8_t *data, uint32_t size) {
+	uint8_t *end = data + size;
+
+	if (size < 8 || (size & 3) != 0 || data[0] != '/')
+		return OSC_FORMAT_ERROR;
+
+	/*
+	 * Header
+	 */
+	uint32_t len = OSCMessageView_getStringSize(data, end);
+
+	if (len == 0)
+		return OSC_FORMAT_ERROR;
+
+	uint8_t *readPtr = data + len;
+
+	/*
+	 * Type description
+	 */
+	if (readPtr >= end || *readPtr != ',')
+		return OSC_FORMAT_ERROR;
+
+	len = OSCMessageView_getStringSize(readPtr, end);
+
+	if (len == 0)
+		return OSC_FORMAT_ERROR;
+
+	view->types = (char*)readPtr + 1;
+	view->argumentCount = strlen(view->types);
+	readPtr += len;
+
+	/*
+	 * Arguments
+	 */
+	view->arguments = readPtr;
+
+	uint32_t i;
+	for (i = 0; i < view->argumentCount; i++) {
+		len = OSCMessageView_getArgumentSize(view->types[i], readPtr, end);
+
+		if (len == 0)
+			return OSC_FORMAT_ERROR;
+
+		readPtr += len;
+	}
+
+	if (readPtr != end)
+		return OSC_FORMAT_ERROR;
+
+	view->data = data;
+	view->size = size;
+	view->cursorPosition = 0;
+	view->cursor = view->arguments;
+
+	return OSC_OK;
+}
+
+char* OSCMessageView_getAddress(OSCMessageView *view) {
+	return (char*)view->data;
+}
+
+uint32_t OSCMessageView_getArgumentCount(OSCMessageView *view) {
+	return view->argumentCount;
+}
+
+char OSCMessageView_getArgumentType(OSCMessageView *view, uint32_t position) {
+	if (position < view->argumentCount)
+		return view->types[position];
+
+	return '\0'; // no argument
+}
+
+/*
+ * Finds the contents of the argument. Sequential lookups continue from the previous one,
+ * so reading all arguments in order walks the message only once.
+ */
+uint8_t* OSCMessageView_seek(OSCMessageView *view, uint32_t position) {
+	if (position < view->cursorPosition) {
+		view->cursorPosition = 0;
+		view->cursor = view->arguments;
+	}
+
+	while (view->cursorPosition < position) {
+		view->cursor += OSCMessageView_getArgumentSize(view->types[view->cursorPosition], view->cursor, view->data + view->size);
+		view->cursorPosition++;
+	}
+
+	return view->cursor;
+}
+
+int32_t OSCMessageView_getArgument_int32(OSCMessageView *view, uint32_t position) {
+	if (position < view->argumentCount && (view->types[position] == 'i' || view->types[position] == 'f')) {
+		return (int32_t)OSCMessageView_read32(OSCMessageView_seek(view, position));
+	}
+
+	return 0;
+}
+
+float OSCMessageView_getArgument_float(OSCMessageView *view, uint32_t position) {
+	if (position < view->argumentCount && (view->types[position] == 'i' || view->types[position] == 'f')) {
+		union { uint32_t i; float f; } tmp;
+		tmp.i = OSCMessageView_read32(OSCMessageView_seek(view, position));
+		return tmp.f;
+	}
+
+	return 0.0f;
+}
+
+char* OSCMessageView_getArgument_string(OSCMessageView *view, uint32_t position) {
+	if (position < view->argumentCount && view->types[position] == 's') {
+		return (char*)OSCMessageView_seek(view, position);
+	}
+
+	return NULL;
+}
+
+uint8_t* OSCMessageView_getArgument_blob(OSCMessageView *view, uint32_t position, uint32_t *size) {
+	if (position < view->argumentCount) {
+		uint8_t *ptr;
+
+		switch (view->types[position]) {
+			case 'b':
+				ptr = OSCMessageView_seek(view, position);
+				*size = OSCMessageView_read32(ptr);
+				return ptr + 4;
+			case 's':
+				ptr = OSCMessageView_seek(view, position);
+				*size = strlen((char*)ptr) + 1;
+				return ptr;
+		}
+	}
+
+	*size = 0;
+	return NULL;
+}
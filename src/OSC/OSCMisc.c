@@ -33,6 +33,8 @@
 
 #include "OSC/OSCMisc.h"
 
+#include "OSC/OSCPacketStream.h"
+
 //TODO: fix these
 #define false	0
 #define true	1
@@ -194,3 +196,12 @@ uint8_t OSCMisc_matchStringPattern(const char *str, const char *p) {
 
 	return !*str;
 }
+
+uint32_t OSCMisc_getTimeout(uint64_t difference) {
+	uint64_t seconds = difference >> 32;
+
+	if (seconds >= OSC_WAIT_FOREVER / 1000000)
+		return OSC_WAIT_FOREVER - 1;
+
+	return seconds*1000000 + (((difference & 0xffffffff)*1000000 + 0xffffffff) >> 32);
+}
@@ -0,0 +1,473 @@
+/**
+ * @file	OSCPattern.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+#include "OSC/OSCPattern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OSC_PREALLOC_SIZE	16
+
+/*
+ * Every segment of the pattern is compiled into a small program (a Thompson NFA).
+ * CHAR, ANY and SET instructions consume one character, SPLIT and JUMP do not, and
+ * MATCH ends the segment program. Matching keeps a list of all the instructions the
+ * name could be at and advances all of them by one character at a time.
+ */
+typedef enum {
+	OSC_OP_CHAR,	/* Character equal to c */
+	OSC_OP_ANY,		/* Any character */
+	OSC_OP_SET,		/* Character in set x */
+	OSC_OP_SPLIT,	/* Continue at both x and y */
+	OSC_OP_JUMP,	/* Continue at x */
+	OSC_OP_MATCH	/* End of the segment */
+} OSCPatternOpcode;
+
+typedef struct _OSCPatternInstruction {
+	uint8_t opcode;
+	uint8_t c;
+	uint32_t x;
+	uint32_t y;
+} OSCPatternInstruction;
+
+typedef struct _OSCPattern {
+	OSCPatternInstruction *program;	/* Programs of all the segments */
+	uint32_t programSize;
+	uint32_t programCapacity;
+
+	uint8_t (*sets)[32];			/* Character sets ([...]) as bitmaps */
+	uint32_t setCount;
+	uint32_t setCapacity;
+
+	uint32_t *segments;				/* First instruction of each segment */
+	uint32_t segmentCount;
+	uint32_t segmentCapacity;
+
+	uint32_t *state;				/* Matching state: two thread lists, a stack and the marks (4*programSize) */
+	uint32_t stateCapacity;
+	uint32_t generation;			/* Marks equal to generation are already in the next thread list */
+
+	OSCAllocator *allocator;
+} OSCPattern;
+
+/*
+ * Private functions
+ */
+
+OSCResult	OSCPattern_reserve(OSCPattern *oscPattern, void **array, uint32_t *capacity, uint32_t count, uint32_t elementSize);
+OSCResult	OSCPattern_emit(OSCPattern *oscPattern, uint8_t opcode, uint8_t c, uint32_t x, uint32_t y);
+OSCResult	OSCPattern_compileSet(OSCPattern *oscPattern, const char **pattern);
+OSCResult	OSCPattern_compileList(OSCPattern *oscPattern, const char **pattern);
+void		OSCPattern_nextGeneration(OSCPattern *oscPattern);
+void		OSCPattern_addThread(OSCPattern *oscPattern, uint32_t *list, uint32_t *count, uint32_t pc);
+uint8_t		OSCPattern_run(OSCPattern *oscPattern, uint32_t segment, const char *name, uint32_t length);
+
+
+OSCPattern* OSCPattern_new(void) {
+	return OSCPattern_newWithAllocator(NULL);
+}
+
+OSCPattern* OSCPattern_newWithAllocator(OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	OSCPattern *pattern = (OSCPattern*)OSCAllocator_malloc(allocator, sizeof(OSCPattern));
+
+	if (pattern == NULL)
+		return NULL;
+
+	pattern->allocator = allocator;
+
+	pattern->program = NULL;
+	pattern->programSize = 0;
+	pattern->programCapacity = 0;
+
+	pattern->sets = NULL;
+	pattern->setCount = 0;
+	pattern->setCapacity = 0;
+
+	pattern->segments = NULL;
+	pattern->segmentCount = 0;
+	pattern->segmentCapacity = 0;
+
+	pattern->state = NULL;
+	pattern->stateCapacity = 0;
+	pattern->generation = 0;
+
+	return pattern;
+}
+
+void OSCPattern_delete(OSCPattern *oscPattern) {
+	OSCAllocator *allocator = oscPattern->allocator;
+
+	OSCAllocator_free(allocator, oscPattern->program);
+	OSCAllocator_free(allocator, oscPattern->sets);
+	OSCAllocator_free(allocator, oscPattern->segments);
+	OSCAllocator_free(allocator, oscPattern->state);
+
+	OSCAllocator_free(allocator, oscPattern);
+}
+
+/*
+ * Grows the array geometrically so it can hold at least count elements
+ */
+OSCResult OSCPattern_reserve(OSCPattern *oscPattern, void **array, uint32_t *capacity, uint32_t count, uint32_t elementSize) {
+	if (*capacity >= count)
+		return OSC_OK;
+
+	uint32_t newCapacity = (*capacity > 0) ? *capacity : OSC_PREALLOC_SIZE;
+	while (newCapacity < count)
+		newCapacity <<= 1;
+
+	void *newArray = OSCAllocator_realloc(oscPattern->allocator, *array, newCapacity*elementSize);
+
+	if (newArray == NULL)
+		return OSC_ALLOC_FAILED;
+
+	*array = newArray;
+	*capacity = newCapacity;
+
+	return OSC_OK;
+}
+
+OSCResult OSCPattern_emit(OSCPattern *oscPattern, uint8_t opcode, uint8_t c, uint32_t x, uint32_t y) {
+	OSCResult res = OSCPattern_reserve(oscPattern, (void**)&oscPattern->program, &oscPattern->programCapacity, oscPattern->programSize + 1, sizeof(OSCPatternInstruction));
+
+	if (res != OSC_OK)
+		return res;
+
+	OSCPatternInstruction *instruction = &oscPattern->program[oscPattern->programSize++];
+	instruction->opcode = opcode;
+	instruction->c = c;
+	instruction->x = x;
+	instruction->y = y;
+
+	return OSC_OK;
+}
+
+/*
+ * [abc], [a-z] or [!a-z]. Range [z-a] contains z, a and nothing in between.
+ */
+OSCResult OSCPattern_compileSet(OSCPattern *oscPattern, const char **pattern) {
+	OSCResult res = OSCPattern_reserve(oscPattern, (void**)&oscPattern->sets, &oscPattern->setCapacity, oscPattern->setCount + 1, sizeof(oscPattern->sets[0]));
+
+	if (res != OSC_OK)
+		return res;
+
+	uint8_t *set = oscPattern->sets[oscPattern->setCount];
+	memset(set, 0, sizeof(oscPattern->sets[0]));
+
+	const char *p = *pattern + 1; // skip '['
+
+	uint8_t negate = (*p == '!');
+	if (negate)
+		p++;
+
+	while (*p != ']') {
+		if (*p == '\0' || *p == '/')
+			return OSC_FORMAT_ERROR;
+
+		uint8_t first = *p++, last = first;
+
+		if (*p == '-' && p[1] != ']' && p[1] != '\0' && p[1] != '/') {
+			last = p[1];
+			p += 2;
+		}
+
+		set[first >> 3] |= 1 << (first & 7);
+		set[last >> 3] |= 1 << (last & 7);
+
+		uint32_t c;
+		for (c = first + 1; c < last; c++)
+			set[c >> 3] |= 1 << (c & 7);
+	}
+
+	if (negate) {
+		uint32_t i;
+		for (i = 0; i < sizeof(oscPattern->sets[0]); i++)
+			set[i] = ~set[i];
+	}
+
+	*pattern = p + 1; // skip ']'
+
+	return OSCPattern_emit(oscPattern, OSC_OP_SET, 0, oscPattern->setCount++, 0);
+}
+
+/*
+ * {foo,bar,baz} is compiled into a chain of SPLITs, one for each string. Each string
+ * ends with a JUMP past the list. The JUMPs are linked through x until the end is known.
+ */
+OSCResult OSCPattern_compileList(OSCPattern *oscPattern, const char **pattern) {
+	const char *p = *pattern + 1; // skip '{'
+	uint32_t jumps = UINT32_MAX;
+
+	while (1) {
+		uint32_t split = oscPattern->programSize;
+		OSCResult res = OSCPattern_emit(oscPattern, OSC_OP_SPLIT, 0, split + 1, 0);
+
+		while (res == OSC_OK && *p != ',' && *p != '}') {
+			if (*p == '\0' || *p == '/')
+				return OSC_FORMAT_ERROR;
+
+			res = OSCPattern_emit(oscPattern, OSC_OP_CHAR, *p++, 0, 0);
+		}
+
+		if (res == OSC_OK)
+			res = OSCPattern_emit(oscPattern, OSC_OP_JUMP, 0, jumps, 0);
+
+		if (res != OSC_OK)
+			return res;
+
+		jumps = oscPattern->programSize - 1;
+
+		if (*p++ == '}') {
+			oscPattern->program[split].opcode = OSC_OP_JUMP;	// no more alternatives
+			break;
+		}
+
+		oscPattern->program[split].y = oscPattern->programSize;
+	}
+
+	while (jumps != UINT32_MAX) {
+		uint32_t next = oscPattern->program[jumps].x;
+		oscPattern->program[jumps].x = oscPattern->programSize;
+		jumps = next;
+	}
+
+	*pattern = p;
+
+	return OSC_OK;
+}
+
+OSCResult OSCPattern_compile(OSCPattern *oscPattern, const char *pattern) {
+	oscPattern->programSize = 0;
+	oscPattern->setCount = 0;
+	oscPattern->segmentCount = 0;
+
+	if (*pattern != '/')
+		return OSC_FORMAT_ERROR;
+
+	const char *p = pattern + 1;
+	OSCResult res = OSC_OK;
+
+	while (res == OSC_OK) {
+		res = OSCPattern_reserve(oscPattern, (void**)&oscPattern->segments, &oscPattern->segmentCapacity, oscPattern->segmentCount + 1, sizeof(uint32_t));
+
+		if (res != OSC_OK)
+			break;
+
+		oscPattern->segments[oscPattern->segmentCount++] = oscPattern->programSize;
+
+		while (res == OSC_OK && *p != '\0' && *p != '/') {
+			switch (*p) {
+				case '*': {
+					uint32_t loop = oscPattern->programSize;
+					res = OSCPattern_emit(oscPattern, OSC_OP_SPLIT, 0, loop + 1, loop + 3);
+					if (res == OSC_OK)
+						res = OSCPattern_emit(oscPattern, OSC_OP_ANY, 0, 0, 0);
+					if (res == OSC_OK)
+						res = OSCPattern_emit(oscPattern, OSC_OP_JUMP, 0, loop, 0);
+
+					while (*p == '*')
+						p++;
+					break;
+				}
+				case '?':
+					res = OSCPattern_emit(oscPattern, OSC_OP_ANY, 0, 0, 0);
+					p++;
+					break;
+				case '[':
+					res = OSCPattern_compileSet(oscPattern, &p);
+					break;
+				case '{':
+					res = OSCPattern_compileList(oscPattern, &p);
+					break;
+				default:
+					res = OSCPattern_emit(oscPattern, OSC_OP_CHAR, *p++, 0, 0);
+					break;
+			}
+		}
+
+		if (res == OSC_OK)
+			res = OSCPattern_emit(oscPattern, OSC_OP_MATCH, 0, 0, 0);
+
+		if (*p++ == '\0')
+			break;
+	}
+
+	/*
+	 * Allocate matching state
+	 */
+	if (res == OSC_OK)
+		res = OSCPattern_reserve(oscPattern, (void**)&oscPattern->state, &oscPattern->stateCapacity, 4*oscPattern->programSize, sizeof(uint32_t));
+
+	if (res == OSC_OK) {
+		memset(oscPattern->state + 3*oscPattern->programSize, 0, oscPattern->programSize*sizeof(uint32_t));
+		oscPattern->generation = 0;
+	}
+
+	if (res != OSC_OK)
+		oscPattern->segmentCount = 0; // nothing matches a broken pattern
+
+	return res;
+}
+
+uint32_t OSCPattern_getSegmentCount(OSCPattern *oscPattern) {
+	return oscPattern->segmentCount;
+}
+
+void OSCPattern_nextGeneration(OSCPattern *oscPattern) {
+	if (++oscPattern->generation == 0) {	// wrapped around, forget the old marks
+		memset(oscPattern->state + 3*oscPattern->programSize, 0, oscPattern->programSize*sizeof(uint32_t));
+		oscPattern->generation = 1;
+	}
+}
+
+/*
+ * Adds the instruction and everything reachable from it without consuming a character
+ */
+void OSCPattern_addThread(OSCPattern *oscPattern, uint32_t *list, uint32_t *count, uint32_t pc) {
+	uint32_t *stack = oscPattern->state + 2*oscPattern->programSize;
+	uint32_t *marks = oscPattern->state + 3*oscPattern->programSize;
+	uint32_t stackSize = 0;
+
+	if (marks[pc] == oscPattern->generation)
+		return;
+
+	marks[pc] = oscPattern->generation;
+	stack[stackSize++] = pc;
+
+	while (stackSize > 0) {
+		OSCPatternInstruction *instruction = &oscPattern->program[stack[--stackSize]];
+
+		switch (instruction->opcode) {
+			case OSC_OP_SPLIT:
+				if (marks[instruction->y] != oscPattern->generation) {
+					marks[instruction->y] = oscPattern->generation;
+					stack[stackSize++] = instruction->y;
+				}
+				/* fall through */
+			case OSC_OP_JUMP:
+				if (marks[instruction->x] != oscPattern->generation) {
+					marks[instruction->x] = oscPattern->generation;
+					stack[stackSize++] = instruction->x;
+				}
+				break;
+			default:
+				list[(*count)++] = instruction - oscPattern->program;
+				break;
+		}
+	}
+}
+
+uint8_t OSCPattern_run(OSCPattern *oscPattern, uint32_t segment, const char *name, uint32_t length) {
+	if (segment >= oscPattern->segmentCount)
+		return 0;
+
+	uint32_t *currentList = oscPattern->state;
+	uint32_t *nextList = oscPattern->state + oscPattern->programSize;
+	uint32_t currentCount = 0, nextCount;
+
+	OSCPattern_nextGeneration(oscPattern);
+	OSCPattern_addThread(oscPattern, currentList, &currentCount, oscPattern->segments[segment]);
+
+	uint32_t i, j;
+	for (i = 0; i < length && currentCount > 0; i++) {
+		uint8_t c = name[i];
+
+		OSCPattern_nextGeneration(oscPattern);
+
+		nextCount = 0;
+		for (j = 0; j < currentCount; j++) {
+			OSCPatternInstruction *instruction = &oscPattern->program[currentList[j]];
+			uint8_t matched = 0;
+
+			switch (instruction->opcode) {
+				case OSC_OP_CHAR:
+					matched = (instruction->c == c);
+					break;
+				case OSC_OP_ANY:
+					matched = 1;
+					break;
+				case OSC_OP_SET:
+					matched = (oscPattern->sets[instruction->x][c >> 3] >> (c & 7)) & 1;
+					break;
+			}
+
+			if (matched)
+				OSCPattern_addThread(oscPattern, nextList, &nextCount, currentList[j] + 1);
+		}
+
+		uint32_t *tmp = currentList;
+		currentList = nextList;
+		nextList = tmp;
+		currentCount = nextCount;
+	}
+
+	if (i < length)
+		return 0;
+
+	for (j = 0; j < currentCount; j++) {
+		if (oscPattern->program[currentList[j]].opcode == OSC_OP_MATCH)
+			return 1;
+	}
+
+	return 0;
+}
+
+uint8_t OSCPattern_matchSegment(OSCPattern *oscPattern, uint32_t segment, const char *name) {
+	return OSCPattern_run(oscPattern, segment, name, strlen(name));
+}
+
+uint8_t OSCPattern_match(OSCPattern *oscPattern, const char *address) {
+	if (*address != '/')
+		return 0;
+
+	const char *name = address + 1;
+	uint32_t segment = 0;
+
+	while (1) {
+		uint32_t length = strcspn(name, "/");
+
+		if (!OSCPattern_run(oscPattern, segment, name, length))
+			return 0;
+
+		segment++;
+
+		if (name[length] == '\0')
+			break;
+
+		name += length + 1;
+	}
+
+	return segment == oscPattern->segmentCount;
+}
@@ -32,54 +32,204 @@
 
 #include "OSC/OSCServer.h"
 #include "OSC/OSCBundle.h"
+#include "OSC/OSCMessageView.h"
 #include "OSC/OSCMisc.h"
-
-#include <MemoryManager/MemoryManager.h>
+#include "OSC/OSCPattern.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct {
-	char* address;
-	OSCMethod method;
-} OSCMessageHandlerEntry;
+#define OSC_INDEX_PREALLOC_SIZE	16
+#define OSC_SCHEDULE_PREALLOC_SIZE	16
+#define OSC_PARSED_PREALLOC_SIZE	8
+
+/*
+ * Handlers are kept in a tree of address nodes, one level per address segment ("/a/b" is
+ * node "b", which is a child of node "a", which is a child of the root node). Message
+ * dispatch walks the tree segment by segment, so it only visits the nodes which can match.
+ */
+typedef struct _OSCAddressNode {
+	char *address;			/* Full address of the node */
+	char *name;				/* Last segment of the address (points into *address) */
+	uint32_t hash;			/* Hash of the full address */
+	struct _OSCAddressNode *parent;
+	struct _OSCAddressNode **children;	/* Child nodes sorted by name */
+	uint32_t childCount;
+	OSCMethod *methods;		/* Handlers of the node in the order they were added */
+	uint32_t methodCount;
+} OSCAddressNode;
 
-typedef struct _OSCMessageLinkedListEntry {
+typedef struct {
+	OSCTimetag timetag;
+	uint32_t sequence;		/* Keeps the messages with equal timetags in the order they were received */
 	OSCMessage *message;
+} OSCScheduledMessage;
+
+typedef struct {
+	OSCMessageView view;
 	OSCTimetag timetag;
-	struct _OSCMessageLinkedListEntry *nextEntry;
-} OSCMessageLinkedListEntry;
+} OSCParsedMessageEntry;
+
+typedef struct {
+	OSCPacketStream *stream;
+	uint8_t pending;		/* Set while the stream can have more packets in the current cycle */
+} OSCStreamEntry;
 
 typedef struct _OSCServer {
-	OSCMessageHandlerEntry *handlers;
+	OSCAddressNode root;	/* Root of the handler tree */
 	uint32_t handlerCount;
-
-	OSCMessageLinkedListEntry *storedMessages;
-	OSCMessageLinkedListEntry *parsedMessages;
+	uint8_t dispatching;	/* Set while handlers are being called (nodes must not be deleted) */
+	OSCPattern *pattern;	/* Compiled address pattern of the message being dispatched */
+
+	OSCAddressNode **index;	/* Hash table (open addressing) of the nodes which have handlers */
+	uint32_t indexSize;		/* Number of slots (power of two) */
+	uint32_t indexCount;	/* Number of used slots */
+
+	OSCScheduledMessage *storedMessages;	/* Binary min-heap of the messages waiting for their timetag */
+	uint32_t storedCount;
+	uint32_t storedCapacity;
+	uint32_t storedSequence;
+	OSCMessage **spareMessages;				/* Handled stored messages which are reused for the new ones */
+	uint32_t spareCount;
+	OSCMessage **keptMessages;				/* Due messages without a matching handler (in order) */
+	uint32_t keptCount;
+	uint32_t keptCapacity;
+	uint8_t handlersChanged;				/* Set when the kept messages have to be tried again */
+	OSCParsedMessageEntry *parsedMessages;	/* Views into the packet which is being handled (one block, reset for every packet) */
+	uint32_t parsedCount;
+	uint32_t parsedCapacity;
+	OSCMessage *viewMessage;				/* Wrapper used to pass the parsed views to the handlers */
+
+	uint8_t *receiveBuffer;		/* Packet buffer which is reused in every cycle */
+	uint32_t receiveBufferSize;
+	uint8_t receiveBufferOwned;	/* Set if the buffer was allocated by the server (and can be grown) */
+	uint32_t maxPacketSize;		/* Larger packets are dropped, 0 if there is no limit */
+	uint32_t batchSlotSize;		/* Slot size of a batch if there is no limit (the largest packet seen) */
+
+	OSCStreamEntry *streams;	/* Streams which are read in every cycle */
+	uint32_t streamCount;
+	uint32_t firstStream;		/* Stream which is read first in the next cycle (turns are rotated) */
+
+	OSCDispatcher dispatcher;	/* Replaces calling the handlers directly (NULL if not set) */
+	void *dispatcherContext;
+
+	OSCWaiter waiter;			/* Waits for all the streams at once (NULL if not set) */
+	void *waiterContext;
+	uint32_t waitTurn;			/* Stream which is waited for next when the streams are waited for in turns */
 
 	OSCTimetag_get getTime;
+	OSCAllocator *allocator;	/* Allocator of the server memory and the stored messages */
 } OSCServer;
 
 
-OSCResult OSCServer_addParsedMessage(OSCServer *server, OSCMessage *message, uint64_t timetag);
+OSCAddressNode* OSCServer_newNode(OSCServer *server, OSCAddressNode *parent, const char *address, uint32_t length);
+void OSCServer_deleteNode(OSCServer *server, OSCAddressNode *node);
+void OSCServer_clearNode(OSCServer *server, OSCAddressNode *node);
+void OSCServer_pruneNode(OSCServer *server, OSCAddressNode *node);
+int32_t OSCServer_compareSegment(const char *name, const char *segment, uint32_t length);
+OSCAddressNode* OSCServer_findChild(OSCAddressNode *node, const char *segment, uint32_t length, uint32_t *position);
+
+uint32_t OSCServer_hashAddress(const char *address);
+OSCResult OSCServer_indexNode(OSCServer *server, OSCAddressNode *node);
+void OSCServer_unindexNode(OSCServer *server, OSCAddressNode *node);
+OSCAddressNode* OSCServer_lookupNode(OSCServer *server, const char *address);
+
+OSCResult OSCServer_addParsedMessage(OSCServer *server, OSCMessageView *view, uint64_t timetag);
+void OSCServer_clearParsedMessages(OSCServer *server);
+uint8_t OSCServer_isScheduledBefore(OSCScheduledMessage *a, OSCScheduledMessage *b);
+OSCResult OSCServer_storeMessage(OSCServer *server, OSCMessage *message, uint64_t timetag);
+void OSCServer_insertStoredMessage(OSCServer *server, OSCScheduledMessage entry);
+OSCMessage* OSCServer_takeStoredMessage(OSCServer *server);
+OSCMessage* OSCServer_newStoredMessage(OSCServer *server, OSCMessageView *view);
+void OSCServer_recycleMessage(OSCServer *server, OSCMessage *message);
+void OSCServer_keepMessage(OSCServer *server, OSCMessage *message);
+uint8_t* OSCServer_reserveReceiveBuffer(OSCServer *server, uint32_t size);
+OSCResult OSCServer_receiveBatch(OSCServer *server, OSCPacketStream *stream, uint8_t *pending);
+uint8_t OSCServer_receivePacket(OSCServer *server, OSCPacketStream *stream);
+uint8_t OSCServer_dropPacket(OSCServer *server, OSCPacketStream *stream, uint32_t size);
+uint8_t OSCServer_receive(OSCServer *server, OSCPacketStream *stream);
+uint32_t OSCServer_findStream(OSCServer *server, OSCPacketStream *stream);
 OSCResult OSCServer_parseBundle(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag);
 OSCResult OSCServer_parseMessage(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag);
 OSCResult OSCServer_parsePacket(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag);
 
+uint8_t OSCServer_dispatchNode(OSCServer *server, OSCPattern *pattern, OSCAddressNode *node, const char *segment, uint32_t depth, OSCMessage *message);
+uint8_t OSCServer_dispatchMessage(OSCServer *server, OSCMessage *message);
+void OSCServer_handleKeptMessages(OSCServer *server);
 void OSCServer_handleStoredMessages(OSCServer *server);
 void OSCServer_handleParsedMessages(OSCServer *server);
 
 OSCServer*	OSCServer_new(OSCTimetag_get func) {
-	OSCServer *server = (OSCServer*)MemoryManager_malloc(sizeof(OSCServer));
+	return OSCServer_newWithAllocator(func, NULL);
+}
+
+OSCServer*	OSCServer_newWithAllocator(OSCTimetag_get func, OSCAllocator *allocator) {
+	if (allocator == NULL)
+		allocator = &OSCAllocator_default;
+
+	OSCServer *server = (OSCServer*)OSCAllocator_malloc(allocator, sizeof(OSCServer));
 
 	if (server == NULL)
 		return NULL;
 
-	server->handlers = NULL;
+	server->allocator = allocator;
+
+	server->root.address = NULL;
+	server->root.name = "";
+	server->root.parent = NULL;
+	server->root.children = NULL;
+	server->root.childCount = 0;
+	server->root.methods = NULL;
+	server->root.methodCount = 0;
 	server->handlerCount = 0;
+	server->dispatching = 0;
+
+	server->index = NULL;
+	server->indexSize = 0;
+	server->indexCount = 0;
 
 	server->storedMessages = NULL;
+	server->storedCount = 0;
+	server->storedCapacity = 0;
+	server->storedSequence = 0;
+	server->spareMessages = NULL;
+	server->spareCount = 0;
+	server->keptMessages = NULL;
+	server->keptCount = 0;
+	server->keptCapacity = 0;
+	server->handlersChanged = 0;
 	server->parsedMessages = NULL;
+	server->parsedCount = 0;
+	server->parsedCapacity = 0;
+
+	server->receiveBuffer = NULL;
+	server->receiveBufferSize = 0;
+	server->receiveBufferOwned = 1;
+	server->maxPacketSize = OSC_MAX_PACKET_SIZE;
+	server->batchSlotSize = OSC_BATCH_SLOT_SIZE;
+
+	server->streams = NULL;
+	server->streamCount = 0;
+	server->firstStream = 0;
+
+	server->viewMessage = OSCMessage_newWithAllocator(allocator);
+	server->pattern = OSCPattern_newWithAllocator(allocator);
+
+	if (server->viewMessage == NULL || server->pattern == NULL) {
+		if (server->viewMessage != NULL)
+			OSCMessage_delete(server->viewMessage);
+		if (server->pattern != NULL)
+			OSCPattern_delete(server->pattern);
+		OSCAllocator_free(allocator, server);
+		return NULL;
+	}
+
+	server->dispatcher = NULL;
+	server->dispatcherContext = NULL;
+
+	server->waiter = NULL;
+	server->waiterContext = NULL;
+	server->waitTurn = 0;
 
 	server->getTime = func;
 
@@ -87,31 +237,247 @@ OSCServer*	OSCServer_new(OSCTimetag_get func) {
 }
 
 void OSCServer_delete(OSCServer *oscServer) {
-	if (oscServer->handlers != NULL) {
+	OSCAllocator *allocator = oscServer->allocator;
+
+	OSCServer_clearNode(oscServer, &oscServer->root);
+	OSCAllocator_free(allocator, oscServer->index);
+
+	uint32_t i;
+	for (i=0; i<oscServer->storedCount; i++) {
+		OSCMessage_delete(oscServer->storedMessages[i].message);
+	}
+	OSCAllocator_free(allocator, oscServer->storedMessages);
+
+	for (i=0; i<oscServer->spareCount; i++) {
+		OSCMessage_delete(oscServer->spareMessages[i]);
+	}
+	OSCAllocator_free(allocator, oscServer->spareMessages);
+
+	for (i=0; i<oscServer->keptCount; i++) {
+		OSCMessage_delete(oscServer->keptMessages[i]);
+	}
+	OSCAllocator_free(allocator, oscServer->keptMessages);
+
+	OSCAllocator_free(allocator, oscServer->parsedMessages);
+
+	if (oscServer->receiveBufferOwned)
+		OSCAllocator_free(allocator, oscServer->receiveBuffer);
+
+	OSCAllocator_free(allocator, oscServer->streams);
+
+	OSCMessage_delete(oscServer->viewMessage);
+	OSCPattern_delete(oscServer->pattern);
+
+	OSCAllocator_free(allocator, oscServer);
+}
+
+OSCAllocator* OSCServer_getAllocator(OSCServer *oscServer) {
+	return oscServer->allocator;
+}
+
+/*
+ * Message handling
+ */
+
+OSCAddressNode* OSCServer_newNode(OSCServer *server, OSCAddressNode *parent, const char *address, uint32_t length) {
+	OSCAddressNode *node = (OSCAddressNode*)OSCAllocator_malloc(server->allocator, sizeof(OSCAddressNode));
+
+	if (node == NULL)
+		return NULL;
+
+	node->address = (char*)OSCAllocator_malloc(server->allocator, length+1); // include the null character
+
+	if (node->address == NULL) {
+		OSCAllocator_free(server->allocator, node);
+		return NULL;
+	}
+
+	memcpy(node->address, address, length);
+	node->address[length] = '\0';
+
+	node->name = strrchr(node->address, '/') + 1;
+	node->hash = OSCServer_hashAddress(node->address);
+	node->parent = parent;
+	node->children = NULL;
+	node->childCount = 0;
+	node->methods = NULL;
+	node->methodCount = 0;
+
+	return node;
+}
+
+void OSCServer_clearNode(OSCServer *server, OSCAddressNode *node) {
+	uint32_t i;
+	for (i=0; i<node->childCount; i++) {
+		OSCServer_deleteNode(server, node->children[i]);
+	}
+	OSCAllocator_free(server->allocator, node->children);
+	OSCAllocator_free(server->allocator, node->methods);
+
+	node->children = NULL;
+	node->childCount = 0;
+	node->methods = NULL;
+	node->methodCount = 0;
+}
+
+void OSCServer_deleteNode(OSCServer *server, OSCAddressNode *node) {
+	OSCServer_clearNode(server, node);
+	OSCAllocator_free(server->allocator, node->address);
+	OSCAllocator_free(server->allocator, node);
+}
+
+/*
+ * Removes the node and then its parents as long as they have no handlers and no children
+ * (unless the tree is being walked)
+ */
+void OSCServer_pruneNode(OSCServer *server, OSCAddressNode *node) {
+	while (!server->dispatching && node != &server->root && node->methodCount == 0 && node->childCount == 0) {
+		OSCAddressNode *parent = node->parent;
+		uint32_t position;
+
+		OSCServer_findChild(parent, node->name, strlen(node->name), &position);
+		memmove(&parent->children[position], &parent->children[position+1], sizeof(OSCAddressNode*)*(parent->childCount-position-1));
+		parent->childCount--;
+
+		OSCServer_deleteNode(server, node);
+		node = parent;
+	}
+}
+
+/*
+ * Compares the node name with the address segment (which is not null terminated)
+ */
+int32_t OSCServer_compareSegment(const char *name, const char *segment, uint32_t length) {
+	int32_t res = strncmp(name, segment, length);
+
+	if (res == 0 && name[length] != '\0')
+		return 1;
+
+	return res;
+}
+
+/*
+ * Binary searches the children of the node. If the child is not found, position is set
+ * to the place where it should be inserted.
+ */
+OSCAddressNode* OSCServer_findChild(OSCAddressNode *node, const char *segment, uint32_t length, uint32_t *position) {
+	uint32_t low = 0, high = node->childCount;
+
+	while (low < high) {
+		uint32_t mid = (low + high) >> 1;
+		int32_t res = OSCServer_compareSegment(node->children[mid]->name, segment, length);
+
+		if (res == 0) {
+			*position = mid;
+			return node->children[mid];
+		}
+
+		if (res < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	*position = low;
+	return NULL;
+}
+
+/*
+ * Literal address index
+ */
+
+uint32_t OSCServer_hashAddress(const char *address) {
+	uint32_t hash = 2166136261u;	// FNV-1a
+
+	while (*address) {
+		hash ^= (uint8_t)*address++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+OSCResult OSCServer_indexNode(OSCServer *server, OSCAddressNode *node) {
+	/*
+	 * Keep the table at most half full
+	 */
+	if (2*(server->indexCount+1) > server->indexSize) {
+		uint32_t newSize = (server->indexSize > 0) ? 2*server->indexSize : OSC_INDEX_PREALLOC_SIZE;
+		OSCAddressNode **newIndex = (OSCAddressNode**)OSCAllocator_malloc(server->allocator, sizeof(OSCAddressNode*)*newSize);
+
+		if (newIndex == NULL)
+			return OSC_ALLOC_FAILED;
+
+		memset(newIndex, 0, sizeof(OSCAddressNode*)*newSize);
+
 		uint32_t i;
-		for (i=0; i<oscServer->handlerCount; i++) {
-			MemoryManager_free(oscServer->handlers[i].address);
+		for (i=0; i<server->indexSize; i++) {
+			if (server->index[i] != NULL) {
+				uint32_t slot = server->index[i]->hash & (newSize-1);
+				while (newIndex[slot] != NULL)
+					slot = (slot+1) & (newSize-1);
+				newIndex[slot] = server->index[i];
+			}
 		}
-		MemoryManager_free(oscServer->handlers);
+
+		OSCAllocator_free(server->allocator, server->index);
+		server->index = newIndex;
+		server->indexSize = newSize;
 	}
 
-	OSCMessageLinkedListEntry *entry = oscServer->storedMessages;
-	while (entry != NULL) {
-		OSCMessage_delete(entry->message);
-		OSCMessageLinkedListEntry *nextEntry = entry->nextEntry;
-		MemoryManager_free(entry);
-		entry = nextEntry;
+	uint32_t slot = node->hash & (server->indexSize-1);
+	while (server->index[slot] != NULL)
+		slot = (slot+1) & (server->indexSize-1);
+
+	server->index[slot] = node;
+	server->indexCount++;
+
+	return OSC_OK;
+}
+
+void OSCServer_unindexNode(OSCServer *server, OSCAddressNode *node) {
+	uint32_t mask = server->indexSize-1;
+	uint32_t slot = node->hash & mask;
+
+	while (server->index[slot] != node)
+		slot = (slot+1) & mask;
+
+	/*
+	 * Move back the following entries which would not be found with the hole in place
+	 */
+	uint32_t next = slot;
+	while (1) {
+		next = (next+1) & mask;
+
+		if (server->index[next] == NULL)
+			break;
+
+		uint32_t home = server->index[next]->hash & mask;
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			server->index[slot] = server->index[next];
+			slot = next;
+		}
 	}
 
-	entry = oscServer->parsedMessages;
-	while (entry != NULL) {
-		OSCMessage_delete(entry->message);
-		OSCMessageLinkedListEntry *nextEntry = entry->nextEntry;
-		MemoryManager_free(entry);
-		entry = nextEntry;
+	server->index[slot] = NULL;
+	server->indexCount--;
+}
+
+OSCAddressNode* OSCServer_lookupNode(OSCServer *server, const char *address) {
+	if (server->indexCount == 0)
+		return NULL;
+
+	uint32_t hash = OSCServer_hashAddress(address);
+	uint32_t slot = hash & (server->indexSize-1);
+
+	while (server->index[slot] != NULL) {
+		if (server->index[slot]->hash == hash && strcmp(server->index[slot]->address, address) == 0)
+			return server->index[slot];
+
+		slot = (slot+1) & (server->indexSize-1);
 	}
 
-	MemoryManager_free(oscServer);
+	return NULL;
 }
 
 /*
@@ -119,89 +485,314 @@ void OSCServer_delete(OSCServer *oscServer) {
  */
 
 OSCResult OSCServer_addMessageHandler(OSCServer *oscServer, const char* address, OSCMethod method) {
-	//TODO: check if address is valid
-	uint32_t len = strlen(address);
-	char *addrCopy = (char*)MemoryManager_malloc(len+1); // include the null character
+	if (*address != '/')
+		return OSC_FORMAT_ERROR;
 
-	if (addrCopy == NULL)
+#if OSC_MAX_HANDLERS > 0
+	if (oscServer->handlerCount >= OSC_MAX_HANDLERS)
 		return OSC_ALLOC_FAILED;
+#endif
+
+	/*
+	 * Find or create the node for each address segment
+	 */
+	OSCAddressNode *node = &oscServer->root;
+	const char *segment = address + 1;
+
+	while (1) {
+		uint32_t length = strcspn(segment, "/");
+		uint32_t position;
+
+		OSCAddressNode *child = OSCServer_findChild(node, segment, length, &position);
 
-	OSCMessageHandlerEntry *newHandlers = (OSCMessageHandlerEntry*)MemoryManager_realloc(oscServer->handlers, sizeof(OSCMessageHandlerEntry)*(oscServer->handlerCount+1));
+		if (child == NULL) {
+			OSCAddressNode **newChildren = (OSCAddressNode**)OSCAllocator_realloc(oscServer->allocator, node->children, sizeof(OSCAddressNode*)*(node->childCount+1));
 
-	if (newHandlers == NULL) {
-		MemoryManager_free(addrCopy);
+			if (newChildren == NULL) {
+				OSCServer_pruneNode(oscServer, node);	// remove the nodes created for this handler
+				return OSC_ALLOC_FAILED;
+			}
+
+			node->children = newChildren;
+
+			child = OSCServer_newNode(oscServer, node, address, segment + length - address);
+
+			if (child == NULL) {
+				OSCServer_pruneNode(oscServer, node);
+				return OSC_ALLOC_FAILED;
+			}
+
+			memmove(&node->children[position+1], &node->children[position], sizeof(OSCAddressNode*)*(node->childCount-position));
+			node->children[position] = child;
+			node->childCount++;
+		}
+
+		node = child;
+
+		if (segment[length] == '\0')
+			break;
+
+		segment += length + 1;
+	}
+
+	/*
+	 * Add the handler to the node (and the node to the index if it is the first one)
+	 */
+	if (node->methodCount == 0 && OSCServer_indexNode(oscServer, node) != OSC_OK) {
+		OSCServer_pruneNode(oscServer, node);
 		return OSC_ALLOC_FAILED;
 	}
 
-	memcpy(addrCopy, address, len+1);
+	OSCMethod *newMethods = (OSCMethod*)OSCAllocator_realloc(oscServer->allocator, node->methods, sizeof(OSCMethod)*(node->methodCount+1));
 
-	oscServer->handlers = newHandlers;
-	oscServer->handlers[oscServer->handlerCount].address = addrCopy;
-	oscServer->handlers[oscServer->handlerCount].method  = method;
+	if (newMethods == NULL) {
+		if (node->methodCount == 0) {
+			OSCServer_unindexNode(oscServer, node);
+			OSCServer_pruneNode(oscServer, node);
+		}
+		return OSC_ALLOC_FAILED;
+	}
+
+	node->methods = newMethods;
+	node->methods[node->methodCount] = method;
+	node->methodCount++;
 	oscServer->handlerCount++;
+	oscServer->handlersChanged = 1;
 
 	return OSC_OK;
 }
 
 OSCResult OSCServer_removeMessageHandler(OSCServer *oscServer, const char* address, OSCMethod method) {
+	OSCAddressNode *node = OSCServer_lookupNode(oscServer, address);
+
+	if (node == NULL)	// handler not found
+		return OSC_ERROR;
 
 	uint32_t i;
-	for (i=0; i<oscServer->handlerCount; i++) {
-		if (oscServer->handlers[i].method == method && strcmp(oscServer->handlers[i].address, address) == 0)
+	for (i=0; i<node->methodCount; i++) {
+		if (node->methods[i] == method)
 			break;
 	}
 
-	if (i == oscServer->handlerCount)	// handler not found
+	if (i == node->methodCount)	// handler not found
 		return OSC_ERROR;
 
-	MemoryManager_free(oscServer->handlers[i].address);
+	if (i+1 < node->methodCount) { // if it's not the last handler
+		memmove(&node->methods[i], &node->methods[i+1], sizeof(OSCMethod)*(node->methodCount-i-1));
+	}
+	node->methodCount--;
+	oscServer->handlerCount--;
 
-	if (i+1 < oscServer->handlerCount) { // if it's not the last handler
-		memmove(&oscServer->handlers[i], &oscServer->handlers[i+1], sizeof(OSCMessageHandlerEntry)*(oscServer->handlerCount-i-1));
+	if (node->methodCount == 0) {
+		OSCServer_unindexNode(oscServer, node);
+		OSCServer_pruneNode(oscServer, node);	// remove the nodes which are not needed anymore
 	}
 
-	OSCMessageHandlerEntry *newHandlers = (OSCMessageHandlerEntry*)MemoryManager_realloc(oscServer->handlers, sizeof(OSCMessageHandlerEntry)*(oscServer->handlerCount-1));
+	return OSC_OK;
+}
 
-	if (newHandlers == NULL) {
-		// TODO: make a better handling, as this should NEVER happen
-		oscServer->handlerCount--;
-		return OSC_ALLOC_FAILED;
+
+/*
+ * Message parsing
+ */
+
+/*
+ * Parsed entries are taken from a single block which only grows (geometrically) when a
+ * packet has more messages than any packet before it
+ */
+OSCResult OSCServer_addParsedMessage(OSCServer *server, OSCMessageView *view, uint64_t timetag) {
+	if (server->parsedCount == server->parsedCapacity) {
+		uint32_t newCapacity = (server->parsedCapacity > 0) ? 2*server->parsedCapacity : OSC_PARSED_PREALLOC_SIZE;
+		OSCParsedMessageEntry *newMessages = (OSCParsedMessageEntry*)OSCAllocator_realloc(server->allocator, server->parsedMessages, sizeof(OSCParsedMessageEntry)*newCapacity);
+
+		if (newMessages == NULL)
+			return OSC_ALLOC_FAILED;
+
+		server->parsedMessages = newMessages;
+		server->parsedCapacity = newCapacity;
 	}
 
-	oscServer->handlers = newHandlers;
-	oscServer->handlerCount--;
+	OSCParsedMessageEntry *entry = &server->parsedMessages[server->parsedCount++];
+	entry->view = *view;
+	entry->timetag.raw = timetag;
 
 	return OSC_OK;
 }
 
+/*
+ * Releases all the parsed entries of the packet at once
+ */
+void OSCServer_clearParsedMessages(OSCServer *server) {
+	server->parsedCount = 0;
+}
 
 /*
- * Message parsing
+ * Stored (scheduled) messages
  */
 
-OSCResult OSCServer_addParsedMessage(OSCServer *server, OSCMessage *message, uint64_t timetag) {
-	OSCMessageLinkedListEntry *entry = (OSCMessageLinkedListEntry*)MemoryManager_malloc(sizeof(OSCMessageLinkedListEntry));
+uint8_t OSCServer_isScheduledBefore(OSCScheduledMessage *a, OSCScheduledMessage *b) {
+	if (a->timetag.raw != b->timetag.raw)
+		return a->timetag.raw < b->timetag.raw;
 
-	if (entry == NULL)
-		return OSC_ALLOC_FAILED;
+	return (int32_t)(a->sequence - b->sequence) < 0;
+}
 
-	entry->message = message;
-	entry->timetag.raw = timetag;
-	entry->nextEntry = NULL;
+OSCResult OSCServer_storeMessage(OSCServer *server, OSCMessage *message, uint64_t timetag) {
+	if (server->storedCount == server->storedCapacity) {
+		uint32_t newCapacity = (server->storedCapacity > 0) ? 2*server->storedCapacity : OSC_SCHEDULE_PREALLOC_SIZE;
 
-	if (server->parsedMessages == NULL) {
-		server->parsedMessages = entry;
-	} else {
-		OSCMessageLinkedListEntry *lastEntry;
-		for (lastEntry=server->parsedMessages; lastEntry->nextEntry != NULL; lastEntry=lastEntry->nextEntry);
-		lastEntry->nextEntry = entry;
+#if OSC_MAX_QUEUED_MESSAGES > 0
+		if (server->storedCapacity >= OSC_MAX_QUEUED_MESSAGES)
+			return OSC_ALLOC_FAILED;
+		if (newCapacity > OSC_MAX_QUEUED_MESSAGES)
+			newCapacity = OSC_MAX_QUEUED_MESSAGES;
+#endif
+
+		OSCScheduledMessage *newMessages = (OSCScheduledMessage*)OSCAllocator_realloc(server->allocator, server->storedMessages, sizeof(OSCScheduledMessage)*newCapacity);
+
+		if (newMessages == NULL)
+			return OSC_ALLOC_FAILED;
+
+		server->storedMessages = newMessages;
+
+		/*
+		 * Every message is either stored or spare, so the spare array never needs more
+		 * slots than the heap
+		 */
+		OSCMessage **newSpareMessages = (OSCMessage**)OSCAllocator_realloc(server->allocator, server->spareMessages, sizeof(OSCMessage*)*newCapacity);
+
+		if (newSpareMessages == NULL)
+			return OSC_ALLOC_FAILED;
+
+		server->spareMessages = newSpareMessages;
+		server->storedCapacity = newCapacity;
+	}
+
+	OSCScheduledMessage entry;
+	entry.timetag.raw = timetag;
+	entry.sequence = server->storedSequence++;
+	entry.message = message;
+
+	OSCServer_insertStoredMessage(server, entry);
+
+	return OSC_OK;
+}
+
+/*
+ * Adds the entry to the heap, there must be a free slot for it
+ */
+void OSCServer_insertStoredMessage(OSCServer *server, OSCScheduledMessage entry) {
+	/*
+	 * Sift up
+	 */
+	uint32_t i = server->storedCount++;
+	while (i > 0) {
+		uint32_t parent = (i-1) >> 1;
+
+		if (!OSCServer_isScheduledBefore(&entry, &server->storedMessages[parent]))
+			break;
+
+		server->storedMessages[i] = server->storedMessages[parent];
+		i = parent;
 	}
+	server->storedMessages[i] = entry;
+}
+
+/*
+ * Removes the earliest message from the heap and returns it
+ */
+OSCMessage* OSCServer_takeStoredMessage(OSCServer *server) {
+	OSCMessage *message = server->storedMessages[0].message;
+	OSCScheduledMessage *last = &server->storedMessages[--server->storedCount];
+
+	/*
+	 * Sift down
+	 */
+	uint32_t i = 0;
+	while (1) {
+		uint32_t child = 2*i + 1;
+
+		if (child >= server->storedCount)
+			break;
+
+		if (child+1 < server->storedCount && OSCServer_isScheduledBefore(&server->storedMessages[child+1], &server->storedMessages[child]))
+			child++;
+
+		if (!OSCServer_isScheduledBefore(&server->storedMessages[child], last))
+			break;
+
+		server->storedMessages[i] = server->storedMessages[child];
+		i = child;
+	}
+	server->storedMessages[i] = *last;
+
+	return message;
+}
+
+/*
+ * Returns a copy of the view for storing, a spare message is reused if there is one
+ */
+OSCMessage* OSCServer_newStoredMessage(OSCServer *server, OSCMessageView *view) {
+	if (server->spareCount == 0)
+		return OSCMessage_newFromViewWithAllocator(view, server->allocator);
+
+	OSCMessage *message = server->spareMessages[--server->spareCount];
+
+	if (OSCMessage_setFromView(message, view) != OSC_OK) {
+		OSCMessage_delete(message);
+		return NULL;
+	}
+
+	return message;
+}
+
+void OSCServer_recycleMessage(OSCServer *server, OSCMessage *message) {
+	if (server->spareCount < server->storedCapacity)
+		server->spareMessages[server->spareCount++] = message;
+	else
+		OSCMessage_delete(message);
+}
+
+/*
+ * Keeps the due message which has no matching handler, it is tried again when a handler
+ * is added
+ */
+void OSCServer_keepMessage(OSCServer *server, OSCMessage *message) {
+	if (server->keptCount == server->keptCapacity) {
+		uint32_t newCapacity = (server->keptCapacity > 0) ? 2*server->keptCapacity : OSC_SCHEDULE_PREALLOC_SIZE;
+
+#if OSC_MAX_QUEUED_MESSAGES > 0
+		if (newCapacity > OSC_MAX_QUEUED_MESSAGES)
+			newCapacity = OSC_MAX_QUEUED_MESSAGES;
+#endif
+
+		OSCMessage **newMessages = NULL;
+		if (newCapacity > server->keptCapacity)
+			newMessages = (OSCMessage**)OSCAllocator_realloc(server->allocator, server->keptMessages, sizeof(OSCMessage*)*newCapacity);
+
+		if (newMessages == NULL) {
+			OSCServer_recycleMessage(server, message);
+			return;
+		}
+
+		server->keptMessages = newMessages;
+		server->keptCapacity = newCapacity;
+	}
+
+	server->keptMessages[server->keptCount++] = message;
+}
+
+OSCResult OSCServer_getNextDeadline(OSCServer *oscServer, uint64_t *timetag) {
+	if (oscServer->storedCount == 0)
+		return OSC_ERROR;
+
+	*timetag = oscServer->storedMessages[0].timetag.raw;
 
 	return OSC_OK;
 }
 
 OSCResult OSCServer_parseBundle(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag) {
-	if (strcmp((char*)data, "#bundle") != 0) {
+	if (size < 16 || strcmp((char*)data, "#bundle") != 0) {
 		return OSC_FORMAT_ERROR;
 	}
 
@@ -221,8 +812,15 @@ OSCResult OSCServer_parseBundle(OSCServer *server, uint8_t *data, uint32_t size,
 		return OSC_FORMAT_ERROR;
 
 	while (readPtr < (data+size)) {
-		int32_t len = (readPtr[0] << 24) | (readPtr[1] << 16) | (readPtr[2] << 8) | (readPtr[3]);
+		if ((data+size) - readPtr < 4)
+			return OSC_FORMAT_ERROR;
+
+		uint32_t len = ((uint32_t)readPtr[0] << 24) | (readPtr[1] << 16) | (readPtr[2] << 8) | (readPtr[3]);
 		readPtr += 4;
+
+		if (len > (uint32_t)((data+size) - readPtr))
+			return OSC_FORMAT_ERROR;
+
 		OSCResult res = OSCServer_parsePacket(server, readPtr, len, bundleTimetag);
 		if (res != OSC_OK)
 			return res;
@@ -236,194 +834,204 @@ OSCResult OSCServer_parseBundle(OSCServer *server, uint8_t *data, uint32_t size,
 }
 
 OSCResult OSCServer_parseMessage(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag) {
-	if (data[0] != '/')
-		return OSC_FORMAT_ERROR;
+	OSCMessageView view;
 
-	OSCMessage *msg = OSCMessage_new();
+	OSCResult res = OSCMessageView_init(&view, data, size);
 
-	if (msg == NULL)
-		return OSC_ALLOC_FAILED;
+	if (res != OSC_OK)
+		return res;
 
-	/*
-	 * Header
-	 */
-	uint8_t *readPtr = data;
+	return OSCServer_addParsedMessage(server, &view, timetag);
+}
 
-	if (OSCMessage_setAddress(msg, (char*)readPtr) != OSC_OK) {
-		OSCMessage_delete(msg);
-		return OSC_ALLOC_FAILED; // Note: only one possible error (yet)
+OSCResult OSCServer_parsePacket(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag) {
+	if (size == 0)
+		return OSC_FORMAT_ERROR;
+
+	if (data[0] == '#') {
+		return OSCServer_parseBundle(server, data, size, timetag);
+	} else if (data[0] == '/') {
+		return OSCServer_parseMessage(server, data, size, timetag);
 	}
-	readPtr += OSCMisc_getPaddedLength(strlen((char*)readPtr)+1);
 
-	/*
-	 * Type description
-	 */
-	if (*readPtr != ',') {
-		OSCMessage_delete(msg);
-		return OSC_FORMAT_ERROR;
+	return OSC_FORMAT_ERROR;
+}
+
+/*
+ * Message handling (checking patterns and calling methods)
+ */
+
+/*
+ * Calls handlers of the node children which match the pattern segment (and continues
+ * with the rest of the pattern). Wildcard segments are matched using the compiled pattern.
+ */
+uint8_t OSCServer_dispatchNode(OSCServer *server, OSCPattern *pattern, OSCAddressNode *node, const char *segment, uint32_t depth, OSCMessage *message) {
+	uint32_t length = strcspn(segment, "/");
+	uint8_t wildcard = (strcspn(segment, "*?[]{}") < length);
+	uint32_t first, last, i;
+
+	if (wildcard) {	// check all children
+		first = 0;
+		last = node->childCount;
+	} else {
+		if (OSCServer_findChild(node, segment, length, &first) == NULL)
+			return 0;
+		last = first + 1;
 	}
 
-	uint32_t argCount = strlen((char*)readPtr) -1 ; // excluding the ',' character
-	uint8_t *typesPtr = readPtr+1;
+	uint8_t executed = 0;
 
-	readPtr += OSCMisc_getPaddedLength(strlen((char*)readPtr)+1);
+	for (i=first; i<last; i++) {
+		OSCAddressNode *child = node->children[i];
 
-	/*
-	 * Arguments
-	 */
-	uint32_t i;
-	for (i = 0; i < argCount; i++) {
-		switch (typesPtr[i]) {
-			case 'i': {
-				int32_t tmp = (readPtr[0] << 24) | (readPtr[1] << 16) | (readPtr[2] << 8) | (readPtr[3]);
-				if (OSCMessage_addArgument_int32(msg, tmp) != OSC_OK) {
-					OSCMessage_delete(msg);
-					return OSC_ALLOC_FAILED; // Note: only one possible error (yet)
-				}
-				readPtr += 4;
-				break;
-			}
-			case 'f': {
-				int32_t tmp = (readPtr[0] << 24) | (readPtr[1] << 16) | (readPtr[2] << 8) | (readPtr[3]);
-				if (OSCMessage_addArgument_float(msg, *((float*)&tmp)) != OSC_OK) {
-					OSCMessage_delete(msg);
-					return OSC_ALLOC_FAILED; // Note: only one possible error (yet)
-				}
-				readPtr += 4;
-				break;
-			}
-			case 's': {
-				if (OSCMessage_addArgument_string(msg, (char*)readPtr) != OSC_OK) {
-					OSCMessage_delete(msg);
-					return OSC_ALLOC_FAILED; // Note: only one possible error (yet)
-				}
-				readPtr += OSCMisc_getPaddedLength(strlen((char*)readPtr)+1);
-				break;
-			}
-			case 'b': {
-				int32_t tmp = (readPtr[0] << 24) | (readPtr[1] << 16) | (readPtr[2] << 8) | (readPtr[3]);
-				readPtr += 4;
-				if (OSCMessage_addArgument_blob(msg, readPtr, tmp) != OSC_OK) {
-					OSCMessage_delete(msg);
-					return OSC_ALLOC_FAILED; // Note: only one possible error (yet)
-				}
-				readPtr += OSCMisc_getPaddedLength(tmp);
-				break;
-			}
-			default: {
-				OSCMessage_delete(msg);
-				return OSC_FORMAT_ERROR;
+		if (wildcard && !OSCPattern_matchSegment(pattern, depth, child->name))
+			continue;
+
+		if (segment[length] == '\0') {
+			uint32_t j;
+			for (j=0; j<child->methodCount; j++) {
+				child->methods[j](message);
+				executed = 1;
 			}
+		} else {
+			executed |= OSCServer_dispatchNode(server, pattern, child, segment + length + 1, depth + 1, message);
 		}
 	}
 
-	/*
-	 * Finalization
-	 */
-	if (readPtr != (data+size)) {
-		OSCMessage_delete(msg);
-		return OSC_FORMAT_ERROR;
-	}
+	return executed;
+}
+
+uint8_t OSCServer_callHandlers(OSCServer *oscServer, OSCMessage *message, OSCPattern *pattern) {
+	const char *address = OSCMessage_getAddress(message);
+
+	if (*address != '/')
+		return 0;
 
-	if (OSCServer_addParsedMessage(server, msg, timetag) != OSC_OK) {
-		OSCMessage_delete(msg);
-		return OSC_ALLOC_FAILED; // Note: only possible error (yet)
+	uint8_t executed = 0;
+
+	if (strpbrk(address, "*?[]{}") == NULL) {	// literal address, a single index lookup
+		OSCAddressNode *node = OSCServer_lookupNode(oscServer, address);
+
+		if (node != NULL) {
+			uint32_t i;
+			for (i=0; i<node->methodCount; i++) {
+				node->methods[i](message);
+				executed = 1;
+			}
+		}
+	} else if (OSCPattern_compile(pattern, address) == OSC_OK) {
+		executed = OSCServer_dispatchNode(oscServer, pattern, &oscServer->root, address + 1, 0, message);
 	}
 
-	return OSC_OK;
+	return executed;
 }
 
-OSCResult OSCServer_parsePacket(OSCServer *server, uint8_t *data, uint32_t size, uint64_t timetag) {
-	if (strcmp((char*)data, "#bundle") == 0) {
-		return OSCServer_parseBundle(server, data, size, timetag);
-	} else if (data[0] == '/') {
-		return OSCServer_parseMessage(server, data, size, timetag);
-	}
+/*
+ * Passes the message to the dispatcher or calls the handlers
+ */
+uint8_t OSCServer_dispatchMessage(OSCServer *server, OSCMessage *message) {
+	if (server->dispatcher != NULL)
+		return server->dispatcher(server->dispatcherContext, message);
 
-	return OSC_FORMAT_ERROR;
+	uint8_t dispatching = server->dispatching;
+	server->dispatching = 1;
+
+	uint8_t executed = OSCServer_callHandlers(server, message, server->pattern);
+
+	server->dispatching = dispatching;
+
+	return executed;
+}
+
+void OSCServer_setDispatcher(OSCServer *oscServer, OSCDispatcher dispatcher, void *context) {
+	oscServer->dispatcher = dispatcher;
+	oscServer->dispatcherContext = context;
+	oscServer->handlersChanged = 1;
 }
 
 /*
- * Message handling (checking patterns and calling methods)
+ * Tries the kept messages again if a handler was added since the last time
  */
+void OSCServer_handleKeptMessages(OSCServer *server) {
+	if (!server->handlersChanged)
+		return;
+
+	server->handlersChanged = 0;
 
+	uint32_t i, count = 0;
+	for (i=0; i<server->keptCount; i++) {
+		OSCMessage *message = server->keptMessages[i];
+
+		if (OSCServer_dispatchMessage(server, message))
+			OSCServer_recycleMessage(server, message);
+		else
+			server->keptMessages[count++] = message;
+	}
+
+	server->keptCount = count;
+}
+
+/*
+ * Calls handlers for the stored messages which are due. Only the due messages are taken
+ * from the heap, so the cost does not depend on how many messages are waiting. Messages
+ * without a matching handler are moved out of the heap, so the top of the heap is always
+ * the next deadline.
+ */
 void OSCServer_handleStoredMessages(OSCServer *server) {
-	if (server->storedMessages == NULL || server->handlerCount == 0)
+	if (server->storedCount == 0)
 		return;
 
 	uint64_t now = server->getTime();
 	if (now == OSCTimetag_immediately)
 		now = 0xffffffffffffffff;
 
-	OSCMessageLinkedListEntry *prevEntry = NULL;
-	OSCMessageLinkedListEntry *entry;
-	for (entry=server->storedMessages; entry != NULL; entry=entry->nextEntry) {
-		if (entry->timetag.raw > now) continue;
-		//TODO: check for message timeout
-
-		uint8_t executed = 0;
-
-		uint32_t i;
-		for (i=0; i<server->handlerCount; i++) {
-			if (OSCMisc_matchStringPattern(server->handlers[i].address, OSCMessage_getAddress(entry->message))) {
-				server->handlers[i].method(entry->message);
-				executed = 1;
-			}
-		}
-
-		if (executed) {
-			if (prevEntry == NULL)
-				server->storedMessages = entry->nextEntry;
-			else
-				prevEntry->nextEntry = entry->nextEntry;
-
-			OSCMessage_delete(entry->message);
-			MemoryManager_free(entry);
-		} else {
-			prevEntry = entry;
-		}
+	//TODO: check for message timeout
+	while (server->storedCount > 0 && server->storedMessages[0].timetag.raw <= now) {
+		OSCMessage *message = OSCServer_takeStoredMessage(server);
 
+		if (OSCServer_dispatchMessage(server, message))
+			OSCServer_recycleMessage(server, message);
+		else
+			OSCServer_keepMessage(server, message);
 	}
 }
 
+/*
+ * Calls handlers for the parsed messages which are due. Handlers get the messages
+ * straight from the packet, only the messages which have to be kept for later cycles
+ * are copied.
+ */
 void OSCServer_handleParsedMessages(OSCServer *server) {
-	if (server->parsedMessages == NULL || server->handlerCount == 0)
+	if (server->parsedCount == 0)
 		return;
 
 	uint64_t now = server->getTime();
 	if (now == OSCTimetag_immediately)
 		now = 0xffffffffffffffff;
 
-	OSCMessageLinkedListEntry *prevEntry = NULL;
-	OSCMessageLinkedListEntry *entry;
-	for (entry = server->parsedMessages; entry != NULL ;
-			entry = entry->nextEntry) {
-		if (entry->timetag.raw > now)
-			continue;
-		//TODO: check for message timeout
+	uint32_t i;
+	for (i=0; i<server->parsedCount; i++) {
+		OSCParsedMessageEntry *entry = &server->parsedMessages[i];
 
-		uint8_t executed = 0;
+		//TODO: check for message timeout
+		if (entry->timetag.raw <= now) {
+			OSCMessage_setView(server->viewMessage, &entry->view);
+			uint8_t executed = OSCServer_dispatchMessage(server, server->viewMessage);
+			OSCMessage_setView(server->viewMessage, NULL);
 
-		uint32_t i;
-		for (i = 0; i < server->handlerCount; i++) {
-			if (OSCMisc_matchStringPattern(server->handlers[i].address,	OSCMessage_getAddress(entry->message))) {
-				server->handlers[i].method(entry->message);
-				executed = 1;
-			}
+			if (executed)
+				continue;
 		}
 
-		if (executed) {
-			if (prevEntry == NULL )
-				server->parsedMessages = entry->nextEntry;
-			else
-				prevEntry->nextEntry = entry->nextEntry;
+		OSCMessage *message = OSCServer_newStoredMessage(server, &entry->view);
 
-			OSCMessage_delete(entry->message);
-			MemoryManager_free(entry);
-		} else {
-			prevEntry = entry;
-		}
+		if (message == NULL)
+			continue;
 
+		if (entry->timetag.raw <= now)
+			OSCServer_keepMessage(server, message);
+		else if (OSCServer_storeMessage(server, message, entry->timetag.raw) != OSC_OK)
+			OSCServer_recycleMessage(server, message);
 	}
 }
 
@@ -431,53 +1039,392 @@ void OSCServer_handleParsedMessages(OSCServer *server) {
  * Server runtime
  */
 
-void OSCServer_cycle(OSCServer *oscServer, OSCPacketStream *stream) {
+/*
+ * Returns the receive buffer if it can hold size bytes, the buffer is grown if it is
+ * owned by the server
+ */
+uint8_t* OSCServer_reserveReceiveBuffer(OSCServer *server, uint32_t size) {
+	if (size <= server->receiveBufferSize)
+		return server->receiveBuffer;
 
-	OSCServer_handleStoredMessages(oscServer);
+	if (!server->receiveBufferOwned)
+		return NULL;
 
-	uint32_t size;
-	while ((size=stream->getPacketSize()) > 0) {
-		uint8_t *data = (uint8_t*)MemoryManager_malloc(size);
+	uint8_t *newBuffer = (uint8_t*)OSCAllocator_realloc(server->allocator, server->receiveBuffer, size);
 
-		if (data == NULL)
-			break;
+	if (newBuffer == NULL)
+		return NULL;
+
+	server->receiveBuffer = newBuffer;
+	server->receiveBufferSize = size;
+
+	return newBuffer;
+}
+
+OSCResult OSCServer_setReceiveBuffer(OSCServer *oscServer, uint8_t *buffer, uint32_t size) {
+	if (oscServer->receiveBufferOwned)
+		OSCAllocator_free(oscServer->allocator, oscServer->receiveBuffer);
+
+	oscServer->receiveBuffer = NULL;
+	oscServer->receiveBufferSize = 0;
+	oscServer->receiveBufferOwned = (buffer == NULL);
+
+	if (buffer != NULL) {
+		oscServer->receiveBuffer = buffer;
+		oscServer->receiveBufferSize = size;
+	} else if (size > 0 && OSCServer_reserveReceiveBuffer(oscServer, size) == NULL) {
+		return OSC_ALLOC_FAILED;
+	}
+
+	return OSC_OK;
+}
+
+void OSCServer_setMaxPacketSize(OSCServer *oscServer, uint32_t size) {
+	oscServer->maxPacketSize = size;
+}
+
+uint32_t OSCServer_getTimeout(OSCServer *oscServer) {
+	if (oscServer->storedCount == 0)
+		return OSC_WAIT_FOREVER;
+
+	uint64_t now = oscServer->getTime();
+	uint64_t deadline = oscServer->storedMessages[0].timetag.raw;
+
+	if (now == OSCTimetag_immediately || deadline <= now)
+		return 0;
+
+	return OSCMisc_getTimeout(deadline - now);
+}
+
+OSCResult OSCServer_handlePacket(OSCServer *oscServer, uint8_t *data, uint32_t size) {
+	OSCResult res = OSCServer_parsePacket(oscServer, data, size, OSCTimetag_immediately);
+
+	/*
+	 * Handle or store parsed messages OR drop them on packet failure
+	 */
+	if (res == OSC_OK)
+		OSCServer_handleParsedMessages(oscServer);
+
+	OSCServer_clearParsedMessages(oscServer);
+
+	return res;
+}
+
+/*
+ * Reads one batch of packets. The receive buffer is split into slots, all the packets of
+ * the batch are parsed and then their messages are handled together.
+ */
+OSCResult OSCServer_receiveBatch(OSCServer *server, OSCPacketStream *stream, uint8_t *pending) {
+	OSCPacketSlot slots[OSC_BATCH_SIZE];
+	uint32_t slotSize = server->maxPacketSize;
+	uint32_t count = OSC_BATCH_SIZE;
+	uint32_t nextSize = 0;
+
+	if (slotSize == 0) {
+		/*
+		 * Without a limit the slots are as large as the largest packet seen so far. The size
+		 * of the pending packet is checked first, so a larger packet is not truncated.
+		 */
+		nextSize = stream->getPacketSize(stream->context);
+
+		if (nextSize == 0) {
+			*pending = 0;
+			return OSC_OK;
+		}
+
+		if (nextSize > server->batchSlotSize)
+			server->batchSlotSize = nextSize;
+
+		slotSize = server->batchSlotSize;
+	}
+
+	uint8_t *buffer = NULL;
+	if (slotSize < 0xffffffff / OSC_BATCH_SIZE - 3) {
+		slotSize = (slotSize + 3) & ~3;	// keep the packets 4-byte aligned
+		buffer = OSCServer_reserveReceiveBuffer(server, count*slotSize);
+	}
+
+	if (buffer == NULL) {
+		server->batchSlotSize = OSC_BATCH_SLOT_SIZE;	// do not try to grow the buffer in every cycle
 
 		/*
-		 * Read and parse packet
+		 * Use as many slots as fit into the buffer of the caller
 		 */
-		stream->readPacket(data);
-		OSCResult res = OSCServer_parsePacket(oscServer, data, size, OSCTimetag_immediately);
-		MemoryManager_free(data);
+		buffer = server->receiveBuffer;
+		count = server->receiveBufferSize / slotSize;
+
+		if (count > OSC_BATCH_SIZE)
+			count = OSC_BATCH_SIZE;
+
+		if (count == 0) {
+			count = 1;
+			slotSize = server->receiveBufferSize;
+		}
+
+		if (buffer == NULL || slotSize == 0)
+			return OSC_ALLOC_FAILED;
+	}
 
+	if (nextSize > slotSize) {
 		/*
-		 * Handle or store parsed messages OR delete them on packet failure
+		 * The pending packet is read alone, the server grows the buffer for it if it can
 		 */
-		if (res == OSC_OK) { // execute parsed messages and store not executed ones
-			OSCServer_handleParsedMessages(oscServer);
-
-			if (oscServer->storedMessages == NULL) {
-				oscServer->storedMessages = oscServer->parsedMessages;
-			} else {
-				OSCMessageLinkedListEntry *lastEntry;
-				for (lastEntry = oscServer->storedMessages; lastEntry->nextEntry != NULL; lastEntry = lastEntry->nextEntry);
-				lastEntry->nextEntry = oscServer->parsedMessages;
-			}
-			oscServer->parsedMessages = NULL;
-		} else {	// delete parsed messages
-			OSCMessageLinkedListEntry *entry = oscServer->parsedMessages;
-			while (entry != NULL) {
-				MemoryManager_free(entry->message);
-				OSCMessageLinkedListEntry * nextEntry = entry->nextEntry;
-				MemoryManager_free(entry);
-				entry = nextEntry;
-			}
-			oscServer->parsedMessages = NULL;
+		*pending = OSCServer_receivePacket(server, stream);
+		return OSC_OK;
+	}
+
+	uint32_t i;
+	for (i=0; i<count; i++) {
+		slots[i].buf = buffer + i*slotSize;
+		slots[i].size = slotSize;
+	}
+
+	uint32_t received = stream->readPackets(stream->context, slots, count);
+
+	/*
+	 * Parse the whole batch, the messages of the malformed packets are dropped
+	 */
+	for (i=0; i<received; i++) {
+		uint32_t parsedCount = server->parsedCount;
+
+		if (slots[i].size > slotSize) {
+			/*
+			 * A larger packet behind the first one is truncated by the stream, the next
+			 * batches have room for it
+			 */
+			if (server->maxPacketSize == 0 && slots[i].size > server->batchSlotSize)
+				server->batchSlotSize = slots[i].size;
+			continue;
 		}
 
+		if (slots[i].size == 0)
+			continue;
+
+		if (OSCServer_parsePacket(server, slots[i].buf, slots[i].size, OSCTimetag_immediately) != OSC_OK)
+			server->parsedCount = parsedCount;
+	}
+
+	OSCServer_handleParsedMessages(server);
+	OSCServer_clearParsedMessages(server);
+
+	*pending = (received == count);	// a short batch means there are no more packets
+
+	return OSC_OK;
+}
+
+/*
+ * Reads one packet, returns 0 if there was no packet pending
+ */
+uint8_t OSCServer_receivePacket(OSCServer *server, OSCPacketStream *stream) {
+	uint32_t size = stream->getPacketSize(stream->context);
+
+	if (size == 0)
+		return 0;
+
+	uint8_t *data = NULL;
+
+	if (server->maxPacketSize == 0 || size <= server->maxPacketSize)
+		data = OSCServer_reserveReceiveBuffer(server, size);
+
+	if (data == NULL)	// the packet does not fit
+		return OSCServer_dropPacket(server, stream, size);
+
+	stream->readPacket(stream->context, data);
+	OSCServer_handlePacket(server, data, size);
+
+	return 1;
+}
+
+/*
+ * Removes the pending packet from the stream without handling it. The packet is not
+ * allocated unless the stream can only read whole packets. Returns 0 only if the packet
+ * could not be removed (then it stays pending).
+ */
+uint8_t OSCServer_dropPacket(OSCServer *server, OSCPacketStream *stream, uint32_t size) {
+	if (stream->skipPacket != NULL) {
+		stream->skipPacket(stream->context);
+		return 1;
+	}
+
+	if (stream->readPackets != NULL) {
+		/*
+		 * The stream truncates a packet which does not fit into the slot
+		 */
+		OSCPacketSlot slot;
+		slot.buf = server->receiveBuffer;
+		slot.size = server->receiveBufferSize;
+
+		if (stream->readPackets(stream->context, &slot, 1) > 0)
+			return 1;
+	}
+
+	uint8_t *data = (uint8_t*)OSCAllocator_malloc(server->allocator, size);
+
+	if (data == NULL)
+		return 0;
+
+	stream->readPacket(stream->context, data);
+	OSCAllocator_free(server->allocator, data);
+
+	return 1;
+}
+
+/*
+ * Reads one batch (or one packet if the stream cannot read batches), returns 0 if the
+ * stream has no more packets pending
+ */
+uint8_t OSCServer_receive(OSCServer *server, OSCPacketStream *stream) {
+	uint8_t pending;
+
+	if (stream->readPackets != NULL && OSCServer_receiveBatch(server, stream, &pending) == OSC_OK)
+		return pending;
+
+	return OSCServer_receivePacket(server, stream);
+}
+
+/*
+ * Returns the position of the stream in the added streams or streamCount if it was not added
+ */
+uint32_t OSCServer_findStream(OSCServer *server, OSCPacketStream *stream) {
+	uint32_t i;
+	for (i=0; i<server->streamCount; i++) {
+		if (server->streams[i].stream == stream)
+			break;
+	}
+
+	return i;
+}
+
+OSCResult OSCServer_addStream(OSCServer *oscServer, OSCPacketStream *stream) {
+	if (OSCServer_findStream(oscServer, stream) < oscServer->streamCount)	// already added
+		return OSC_ERROR;
+
+	OSCStreamEntry *newStreams = (OSCStreamEntry*)OSCAllocator_realloc(oscServer->allocator, oscServer->streams, sizeof(OSCStreamEntry)*(oscServer->streamCount+1));
+
+	if (newStreams == NULL)
+		return OSC_ALLOC_FAILED;
+
+	oscServer->streams = newStreams;
+	oscServer->streams[oscServer->streamCount].stream = stream;
+	oscServer->streams[oscServer->streamCount].pending = 0;
+	oscServer->streamCount++;
+
+	return OSC_OK;
+}
+
+OSCResult OSCServer_removeStream(OSCServer *oscServer, OSCPacketStream *stream) {
+	uint32_t i = OSCServer_findStream(oscServer, stream);
+
+	if (i == oscServer->streamCount)	// stream not found
+		return OSC_ERROR;
+
+	memmove(&oscServer->streams[i], &oscServer->streams[i+1], sizeof(OSCStreamEntry)*(oscServer->streamCount-i-1));
+	oscServer->streamCount--;
+
+	return OSC_OK;
+}
+
+void OSCServer_cycle(OSCServer *oscServer, OSCPacketStream *stream) {
+
+	OSCServer_handleKeptMessages(oscServer);
+	OSCServer_handleStoredMessages(oscServer);
+
+	/*
+	 * The streams take turns (one batch or one packet each) until none of them has packets
+	 * pending, so a busy stream cannot hold back the others. The stream which goes first
+	 * changes every cycle.
+	 */
+	uint32_t i;
+	for (i=0; i<oscServer->streamCount; i++) {
+		oscServer->streams[i].pending = 1;
 	}
+
+	uint32_t first = oscServer->firstStream;
+	oscServer->firstStream = (oscServer->streamCount > 0) ? (first+1) % oscServer->streamCount : 0;
+
+	/*
+	 * The stream of the cycle is skipped if it was added too, so it does not get two turns
+	 */
+	uint8_t pending = (stream != NULL && OSCServer_findStream(oscServer, stream) == oscServer->streamCount);
+	uint8_t active;
+
+	do {
+		active = 0;
+
+		if (pending) {
+			pending = OSCServer_receive(oscServer, stream);
+			active |= pending;
+		}
+
+		for (i=0; i<oscServer->streamCount; i++) {
+			uint32_t j = (first+i) % oscServer->streamCount;
+			OSCPacketStream *current = oscServer->streams[j].stream;
+
+			if (!oscServer->streams[j].pending)
+				continue;
+
+			uint8_t streamPending = OSCServer_receive(oscServer, current);
+
+			/*
+			 * Handlers can add or remove streams, so the entry is looked up again
+			 */
+			if (j < oscServer->streamCount && oscServer->streams[j].stream == current) {
+				oscServer->streams[j].pending = streamPending;
+				active |= streamPending;
+			}
+		}
+	} while (active);
 }
 
 void OSCServer_loop(OSCServer *oscServer, OSCPacketStream *stream) {
-	while (1)
+	while (1) {
 		OSCServer_cycle(oscServer, stream);
+		OSCServer_wait(oscServer, stream, OSC_WAIT_FOREVER);
+	}
+}
+
+void OSCServer_setWaiter(OSCServer *oscServer, OSCWaiter waiter, void *context) {
+	oscServer->waiter = waiter;
+	oscServer->waiterContext = context;
+}
+
+uint8_t OSCServer_wait(OSCServer *oscServer, OSCPacketStream *stream, uint32_t limit) {
+	uint32_t timeout = OSCServer_getTimeout(oscServer);
+
+	if (timeout > limit)
+		timeout = limit;
+
+	if (timeout == 0)
+		return 1;
+
+	if (oscServer->waiter != NULL) {
+		oscServer->waiter(oscServer->waiterContext, timeout);
+		return 1;
+	}
+
+	/*
+	 * Streams 0..streamCount-1 are the added ones, the last one is the stream of the cycle
+	 * (unless it was added too)
+	 */
+	uint32_t count = oscServer->streamCount;
+
+	if (stream != NULL && OSCServer_findStream(oscServer, stream) == oscServer->streamCount)
+		count++;
+
+	if (count > 1 && timeout > OSC_WAIT_SLICE)
+		timeout = OSC_WAIT_SLICE;	// the other streams are read again after the slice
+
+	uint32_t i;
+	for (i=0; i<count; i++) {
+		uint32_t j = (oscServer->waitTurn + i) % count;
+		OSCPacketStream *waitStream = (j < oscServer->streamCount) ? oscServer->streams[j].stream : stream;
+
+		if (waitStream->waitPacket != NULL) {
+			oscServer->waitTurn = j + 1;
+			waitStream->waitPacket(waitStream->context, timeout);
+			return 1;
+		}
+	}
+
+	return 0;
 }
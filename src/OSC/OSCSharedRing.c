@@ -0,0 +1,321 @@
+/**
+ * @file	OSCSharedRing.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+
+#include "OSC/OSCSharedRing.h"
+
+#include <string.h>
+
+#define OSC_SHARED_RING_MAGIC		0x4f534352	/* "OSCR" */
+#define OSC_SHARED_RING_WRAP		0xffffffff	/* Packet size which means that the rest of the ring is skipped */
+#define OSC_SHARED_RING_MIN_SIZE	64
+
+/*
+ * Memory block layout: the header followed by the packets. Every packet is a 32-bit
+ * size (in the host byte order) followed by the data padded to 4 bytes. The positions
+ * only grow, they are wrapped using the mask.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t capacity;			/* Number of bytes for the packets (power of two) */
+	uint8_t padding1[56];
+	uint32_t head;				/* Position of the next packet to read (written by the reader) */
+	uint8_t padding2[60];
+	uint32_t tail;				/* Position of the next packet to write (written by the writer) */
+	uint8_t padding3[60];
+} OSCSharedRingHeader;
+
+struct _OSCSharedRing {
+	OSCPacketStream stream;		/* Interface of the ring (its context points to this structure) */
+	OSCSharedRingHeader *header;
+	uint8_t *data;
+	uint32_t mask;
+	uint32_t reservedSkip;		/* Bytes skipped at the end of the ring by the last reservation */
+	OSCAllocator *allocator;
+};
+
+/*
+ * Private functions
+ */
+
+uint32_t OSCSharedRing_getPacketSize(void *context);
+void OSCSharedRing_readPacket(void *context, uint8_t *buf);
+void OSCSharedRing_skipPacket(void *context);
+void OSCSharedRing_writePacket(void *context, uint8_t *buf, uint32_t size);
+uint32_t OSCSharedRing_readPackets(void *context, OSCPacketSlot *slots, uint32_t count);
+uint8_t* OSCSharedRing_peek(OSCSharedRing *ring, uint32_t *size);
+void OSCSharedRing_release(OSCSharedRing *ring, uint32_t size);
+
+
+uint32_t OSCSharedRing_getMemorySize(uint32_t capacity) {
+	return sizeof(OSCSharedRingHeader) + capacity;
+}
+
+OSCResult OSCSharedRing_format(void *memory, uint32_t size) {
+	if (((uintptr_t)memory & 63) != 0 || size < sizeof(OSCSharedRingHeader) + OSC_SHARED_RING_MIN_SIZE)
+		return OSC_ERROR;
+
+	uint32_t capacity = OSC_SHARED_RING_MIN_SIZE;
+	while (capacity < 0x40000000 && sizeof(OSCSharedRingHeader) + 2*capacity <= size)
+		capacity *= 2;
+
+	OSCSharedRingHeader *header = (OSCSharedRingHeader*)memory;
+	memset(header, 0, sizeof(OSCSharedRingHeader));
+	header->capacity = capacity;
+	__atomic_store_n(&header->magic, OSC_SHARED_RING_MAGIC, __ATOMIC_RELEASE);
+
+	return OSC_OK;
+}
+
+OSCSharedRing* OSCSharedRing_open(void *memory) {
+	OSCSharedRingHeader *header = (OSCSharedRingHeader*)memory;
+
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != OSC_SHARED_RING_MAGIC)
+		return NULL;
+
+	OSCAllocator *allocator = &OSCAllocator_default;
+	OSCSharedRing *ring = (OSCSharedRing*)OSCAllocator_malloc(allocator, sizeof(OSCSharedRing));
+
+	if (ring == NULL)
+		return NULL;
+
+	ring->stream.getPacketSize = OSCSharedRing_getPacketSize;
+	ring->stream.readPacket = OSCSharedRing_readPacket;
+	ring->stream.writePacket = OSCSharedRing_writePacket;
+	ring->stream.waitPacket = NULL;
+	ring->stream.readPackets = OSCSharedRing_readPackets;
+	ring->stream.skipPacket = OSCSharedRing_skipPacket;
+	ring->stream.context = ring;
+
+	ring->header = header;
+	ring->data = (uint8_t*)memory + sizeof(OSCSharedRingHeader);
+	ring->mask = header->capacity - 1;
+	ring->reservedSkip = 0;
+	ring->allocator = allocator;
+
+	return ring;
+}
+
+void OSCSharedRing_close(OSCSharedRing *ring) {
+	OSCAllocator_free(ring->allocator, ring);
+}
+
+OSCPacketStream* OSCSharedRing_getStream(OSCSharedRing *ring) {
+	return &ring->stream;
+}
+
+/*
+ * Writer
+ */
+
+uint8_t* OSCSharedRing_reserve(OSCSharedRing *ring, uint32_t size) {
+	uint32_t capacity = ring->mask + 1;
+
+	if (size > capacity/2 - 4)
+		return NULL;
+
+	uint32_t length = 4 + ((size + 3) & ~3);
+	uint32_t tail = ring->header->tail;	// only the writer changes it
+	uint32_t head = __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+	uint32_t position = tail & ring->mask;
+
+	/*
+	 * The packet must be contiguous, if it does not fit before the end of the ring the
+	 * rest of the ring is skipped
+	 */
+	uint32_t skip = (capacity - position < length) ? capacity - position : 0;
+
+	if (tail + skip + length - head > capacity)	// full
+		return NULL;
+
+	if (skip > 0) {
+		*(uint32_t*)(ring->data + position) = OSC_SHARED_RING_WRAP;
+		position = 0;
+	}
+
+	ring->reservedSkip = skip;
+
+	return ring->data + position + 4;
+}
+
+void OSCSharedRing_commit(OSCSharedRing *ring, uint32_t size) {
+	uint32_t tail = ring->header->tail + ring->reservedSkip;
+
+	*(uint32_t*)(ring->data + (tail & ring->mask)) = size;
+
+	__atomic_store_n(&ring->header->tail, tail + 4 + ((size + 3) & ~3), __ATOMIC_RELEASE);
+	ring->reservedSkip = 0;
+}
+
+OSCResult OSCSharedRing_sendMessage(OSCSharedRing *ring, OSCMessage *oscMessage) {
+	uint32_t size = OSCMessage_getPaddedLength(oscMessage);
+	uint8_t *data = OSCSharedRing_reserve(ring, size);
+
+	if (data == NULL)
+		return OSC_ERROR;
+
+	OSCMessage_dump(oscMessage, data);
+	OSCSharedRing_commit(ring, size);
+
+	return OSC_OK;
+}
+
+OSCResult OSCSharedRing_sendBundle(OSCSharedRing *ring, OSCBundle *oscBundle) {
+	uint32_t size = OSCBundle_getPaddedLength(oscBundle);
+	uint8_t *data = OSCSharedRing_reserve(ring, size);
+
+	if (data == NULL)
+		return OSC_ERROR;
+
+	OSCBundle_dump(oscBundle, data);
+	OSCSharedRing_commit(ring, size);
+
+	return OSC_OK;
+}
+
+void OSCSharedRing_writePacket(void *context, uint8_t *buf, uint32_t size) {
+	OSCSharedRing *ring = (OSCSharedRing*)context;
+	uint8_t *data = OSCSharedRing_reserve(ring, size);
+
+	if (data == NULL)	// full, the packet is dropped
+		return;
+
+	memcpy(data, buf, size);
+	OSCSharedRing_commit(ring, size);
+}
+
+/*
+ * Reader
+ */
+
+/*
+ * Returns the next packet (it stays in the ring until it is released) or NULL if there
+ * is none
+ */
+uint8_t* OSCSharedRing_peek(OSCSharedRing *ring, uint32_t *size) {
+	uint32_t head = ring->header->head;	// only the reader changes it
+	uint32_t tail = __atomic_load_n(&ring->header->tail, __ATOMIC_ACQUIRE);
+
+	while (head != tail) {
+		uint32_t position = head & ring->mask;
+		uint32_t packetSize = *(uint32_t*)(ring->data + position);
+
+		if (packetSize == OSC_SHARED_RING_WRAP) {
+			head += ring->mask + 1 - position;
+			__atomic_store_n(&ring->header->head, head, __ATOMIC_RELEASE);
+			continue;
+		}
+
+		if (packetSize > (ring->mask + 1)/2 - 4) {	// corrupted, drop everything
+			__atomic_store_n(&ring->header->head, tail, __ATOMIC_RELEASE);
+			return NULL;
+		}
+
+		*size = packetSize;
+		return ring->data + position + 4;
+	}
+
+	return NULL;
+}
+
+void OSCSharedRing_release(OSCSharedRing *ring, uint32_t size) {
+	__atomic_store_n(&ring->header->head, ring->header->head + 4 + ((size + 3) & ~3), __ATOMIC_RELEASE);
+}
+
+uint32_t OSCSharedRing_handlePackets(OSCSharedRing *ring, OSCServer *oscServer) {
+	uint32_t count = 0;
+	uint32_t size;
+	uint8_t *data;
+
+	while ((data = OSCSharedRing_peek(ring, &size)) != NULL) {
+		if (size > 0)
+			OSCServer_handlePacket(oscServer, data, size);
+
+		OSCSharedRing_release(ring, size);
+		count++;
+	}
+
+	return count;
+}
+
+uint32_t OSCSharedRing_getPacketSize(void *context) {
+	OSCSharedRing *ring = (OSCSharedRing*)context;
+	uint32_t size;
+
+	/*
+	 * Empty packets are skipped, 0 means there is no packet
+	 */
+	while (OSCSharedRing_peek(ring, &size) != NULL) {
+		if (size > 0)
+			return size;
+
+		OSCSharedRing_release(ring, 0);
+	}
+
+	return 0;
+}
+
+void OSCSharedRing_readPacket(void *context, uint8_t *buf) {
+	OSCSharedRing *ring = (OSCSharedRing*)context;
+	uint32_t size;
+	uint8_t *data = OSCSharedRing_peek(ring, &size);
+
+	if (data == NULL)
+		return;
+
+	memcpy(buf, data, size);
+	OSCSharedRing_release(ring, size);
+}
+
+void OSCSharedRing_skipPacket(void *context) {
+	OSCSharedRing *ring = (OSCSharedRing*)context;
+	uint32_t size;
+
+	if (OSCSharedRing_peek(ring, &size) != NULL)
+		OSCSharedRing_release(ring, size);
+}
+
+uint32_t OSCSharedRing_readPackets(void *context, OSCPacketSlot *slots, uint32_t count) {
+	OSCSharedRing *ring = (OSCSharedRing*)context;
+	uint32_t i, size;
+	uint8_t *data;
+
+	for (i=0; i<count && (data = OSCSharedRing_peek(ring, &size)) != NULL; i++) {
+		if (size <= slots[i].size)
+			memcpy(slots[i].buf, data, size);
+
+		slots[i].size = size;	// larger than the slot if the packet did not fit
+		OSCSharedRing_release(ring, size);
+	}
+
+	return i;
+}
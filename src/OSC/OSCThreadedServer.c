@@ -0,0 +1,400 @@
+/**
+ * @file	OSCThreadedServer.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+
+#include "OSC/OSCThreadedServer.h"
+
+#ifdef OSC_THREADS
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdlib.h>
+
+#define OSC_THREADED_WAIT_LIMIT	10000	/* Longest wait of the receiver (in microseconds) */
+
+/*
+ * Single-producer single-consumer ring of messages. The producer only writes the tail and
+ * the consumer only writes the head, so no locks are needed. The indices are kept on
+ * separate cache lines.
+ */
+typedef struct _OSCRing {
+	OSCMessage **slots;
+	uint32_t mask;				/* Number of slots - 1 (power of two) */
+	uint8_t padding1[64];
+	uint32_t head;				/* Next slot to read */
+	uint8_t padding2[64];
+	uint32_t tail;				/* Next slot to write */
+	uint8_t padding3[64];
+} OSCRing;
+
+typedef struct _OSCWorker {
+	struct _OSCThreadedServer *threadedServer;
+	pthread_t thread;
+	OSCPattern *pattern;		/* Each worker matches the addresses with its own pattern */
+	OSCRing queue;				/* Messages to be handled (receiver -> worker) */
+	OSCRing returned;			/* Handled messages which are reused (worker -> receiver) */
+	sem_t pending;				/* Counts the messages in the queue, workers sleep on it */
+} OSCWorker;
+
+typedef struct _OSCThreadedServer {
+	OSCServer *server;
+	OSCPacketStream *stream;
+	OSCAllocator *allocator;	/* Allocator of the server */
+
+	OSCWorker *workers;
+	uint32_t workerCount;
+	uint32_t nextWorker;
+	uint8_t sharding;			/* Messages are assigned to the workers by the address hash */
+	uint32_t shardDepth;		/* Number of the address segments which are hashed (0 - all) */
+
+	pthread_t receiver;
+	uint8_t running;
+	uint8_t started;
+} OSCThreadedServer;
+
+/*
+ * Private functions
+ */
+
+OSCResult	OSCThreadedServer_initRing(OSCRing *ring, uint32_t size, OSCAllocator *allocator);
+uint8_t		OSCThreadedServer_push(OSCRing *ring, OSCMessage *message);
+OSCMessage*	OSCThreadedServer_pop(OSCRing *ring);
+void		OSCThreadedServer_clearRing(OSCRing *ring, OSCAllocator *allocator);
+OSCWorker*	OSCThreadedServer_selectWorker(OSCThreadedServer *threadedServer, OSCMessage *message);
+uint8_t		OSCThreadedServer_dispatch(void *context, OSCMessage *message);
+void*		OSCThreadedServer_receive(void *arg);
+void*		OSCThreadedServer_work(void *arg);
+
+
+OSCThreadedServer* OSCThreadedServer_new(OSCServer *oscServer, OSCPacketStream *stream, uint32_t workerCount, uint32_t queueSize) {
+	if (workerCount == 0)
+		return NULL;
+
+	OSCAllocator *allocator = OSCServer_getAllocator(oscServer);
+	OSCThreadedServer *threadedServer = (OSCThreadedServer*)OSCAllocator_malloc(allocator, sizeof(OSCThreadedServer));
+
+	if (threadedServer == NULL)
+		return NULL;
+
+	threadedServer->server = oscServer;
+	threadedServer->stream = stream;
+	threadedServer->allocator = allocator;
+	threadedServer->workerCount = 0;
+	threadedServer->nextWorker = 0;
+	threadedServer->sharding = 0;
+	threadedServer->shardDepth = 0;
+	threadedServer->running = 0;
+	threadedServer->started = 0;
+
+	threadedServer->workers = (OSCWorker*)OSCAllocator_malloc(allocator, sizeof(OSCWorker)*workerCount);
+
+	if (threadedServer->workers == NULL) {
+		OSCThreadedServer_delete(threadedServer);
+		return NULL;
+	}
+
+	/*
+	 * At most queueSize+2 messages of a worker are in circulation (the queue, the one being
+	 * handled and the one being copied by the receiver), so the ring of returned messages
+	 * never overflows when it has room for all of them
+	 */
+	uint32_t i;
+	for (i=0; i<workerCount; i++) {
+		OSCWorker *worker = &threadedServer->workers[i];
+
+		worker->threadedServer = threadedServer;
+		worker->pattern = OSCPattern_newWithAllocator(allocator);
+		worker->queue.slots = NULL;
+		worker->returned.slots = NULL;
+
+		if (worker->pattern == NULL
+				|| OSCThreadedServer_initRing(&worker->queue, queueSize, allocator) != OSC_OK
+				|| OSCThreadedServer_initRing(&worker->returned, worker->queue.mask+1 + 2, allocator) != OSC_OK
+				|| sem_init(&worker->pending, 0, 0) != 0) {
+			if (worker->pattern != NULL)
+				OSCPattern_delete(worker->pattern);
+			OSCAllocator_free(allocator, worker->queue.slots);
+			OSCAllocator_free(allocator, worker->returned.slots);
+			OSCThreadedServer_delete(threadedServer);
+			return NULL;
+		}
+
+		threadedServer->workerCount++;
+	}
+
+	return threadedServer;
+}
+
+void OSCThreadedServer_delete(OSCThreadedServer *threadedServer) {
+	OSCAllocator *allocator = threadedServer->allocator;
+
+	OSCThreadedServer_stop(threadedServer);
+
+	uint32_t i;
+	for (i=0; i<threadedServer->workerCount; i++) {
+		OSCWorker *worker = &threadedServer->workers[i];
+
+		OSCThreadedServer_clearRing(&worker->queue, allocator);
+		OSCThreadedServer_clearRing(&worker->returned, allocator);
+		OSCPattern_delete(worker->pattern);
+		sem_destroy(&worker->pending);
+	}
+
+	OSCAllocator_free(allocator, threadedServer->workers);
+	OSCAllocator_free(allocator, threadedServer);
+}
+
+void OSCThreadedServer_setSharding(OSCThreadedServer *threadedServer, uint8_t sharding, uint32_t depth) {
+	threadedServer->sharding = sharding;
+	threadedServer->shardDepth = depth;
+}
+
+OSCResult OSCThreadedServer_start(OSCThreadedServer *threadedServer) {
+	if (threadedServer->started)
+		return OSC_ERROR;
+
+	OSCServer_setDispatcher(threadedServer->server, OSCThreadedServer_dispatch, threadedServer);
+	__atomic_store_n(&threadedServer->running, 1, __ATOMIC_RELEASE);
+
+	uint32_t i;
+	for (i=0; i<threadedServer->workerCount; i++) {
+		if (pthread_create(&threadedServer->workers[i].thread, NULL, OSCThreadedServer_work, &threadedServer->workers[i]) != 0)
+			break;
+	}
+
+	if (i < threadedServer->workerCount
+			|| pthread_create(&threadedServer->receiver, NULL, OSCThreadedServer_receive, threadedServer) != 0) {
+		/*
+		 * Stop the workers which were started
+		 */
+		uint32_t count = i, j;
+		for (j=0; j<count; j++)
+			sem_post(&threadedServer->workers[j].pending);
+		for (j=0; j<count; j++)
+			pthread_join(threadedServer->workers[j].thread, NULL);
+
+		__atomic_store_n(&threadedServer->running, 0, __ATOMIC_RELEASE);
+		OSCServer_setDispatcher(threadedServer->server, NULL, NULL);
+		return OSC_ERROR;
+	}
+
+	threadedServer->started = 1;
+
+	return OSC_OK;
+}
+
+void OSCThreadedServer_stop(OSCThreadedServer *threadedServer) {
+	if (!threadedServer->started)
+		return;
+
+	__atomic_store_n(&threadedServer->running, 0, __ATOMIC_RELEASE);
+	pthread_join(threadedServer->receiver, NULL);
+
+	/*
+	 * A wakeup without a message stops the worker (after it handles the queued ones)
+	 */
+	uint32_t i;
+	for (i=0; i<threadedServer->workerCount; i++)
+		sem_post(&threadedServer->workers[i].pending);
+	for (i=0; i<threadedServer->workerCount; i++)
+		pthread_join(threadedServer->workers[i].thread, NULL);
+
+	OSCServer_setDispatcher(threadedServer->server, NULL, NULL);
+	threadedServer->started = 0;
+}
+
+/*
+ * Rings
+ */
+
+OSCResult OSCThreadedServer_initRing(OSCRing *ring, uint32_t size, OSCAllocator *allocator) {
+	uint32_t capacity = 1;
+	while (capacity < size)
+		capacity <<= 1;
+
+	ring->slots = (OSCMessage**)OSCAllocator_malloc(allocator, sizeof(OSCMessage*)*capacity);
+
+	if (ring->slots == NULL)
+		return OSC_ALLOC_FAILED;
+
+	ring->mask = capacity - 1;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return OSC_OK;
+}
+
+uint8_t OSCThreadedServer_push(OSCRing *ring, OSCMessage *message) {
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	if (tail - head > ring->mask)
+		return 0;
+
+	ring->slots[tail & ring->mask] = message;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+OSCMessage* OSCThreadedServer_pop(OSCRing *ring) {
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+		return NULL;
+
+	OSCMessage *message = ring->slots[head & ring->mask];
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	return message;
+}
+
+void OSCThreadedServer_clearRing(OSCRing *ring, OSCAllocator *allocator) {
+	OSCMessage *message;
+	while ((message = OSCThreadedServer_pop(ring)) != NULL)
+		OSCMessage_delete(message);
+
+	OSCAllocator_free(allocator, ring->slots);
+}
+
+/*
+ * Threads
+ */
+
+/*
+ * Selects the worker for the message. With sharding, the messages with the same address
+ * (or the same first shardDepth segments) always go to the same worker, which handles
+ * them in the order they were received.
+ */
+OSCWorker* OSCThreadedServer_selectWorker(OSCThreadedServer *threadedServer, OSCMessage *message) {
+	if (!threadedServer->sharding) {
+		OSCWorker *worker = &threadedServer->workers[threadedServer->nextWorker];
+		threadedServer->nextWorker = (threadedServer->nextWorker + 1) % threadedServer->workerCount;
+		return worker;
+	}
+
+	/*
+	 * FNV-1a hash of the address prefix
+	 */
+	const char *address = OSCMessage_getAddress(message);
+	uint32_t hash = 2166136261u;
+	uint32_t segments = 0;
+
+	for (; *address != '\0'; address++) {
+		if (*address == '/' && threadedServer->shardDepth > 0 && segments++ == threadedServer->shardDepth)
+			break;
+
+		hash ^= (uint8_t)*address;
+		hash *= 16777619u;
+	}
+
+	return &threadedServer->workers[hash % threadedServer->workerCount];
+}
+
+/*
+ * Called by the receiver thread (through OSCServer) for every due message. The message is
+ * copied into a message returned by the worker (or a new one) and queued.
+ */
+uint8_t OSCThreadedServer_dispatch(void *context, OSCMessage *message) {
+	OSCThreadedServer *threadedServer = (OSCThreadedServer*)context;
+	OSCWorker *worker = OSCThreadedServer_selectWorker(threadedServer, message);
+
+	OSCMessage *copy = OSCThreadedServer_pop(&worker->returned);
+
+	if (copy == NULL)
+		copy = OSCMessage_newWithAllocator(threadedServer->allocator);
+
+	if (copy == NULL)
+		return 0;
+
+	if (OSCMessage_copy(copy, message) != OSC_OK) {
+		OSCMessage_delete(copy);
+		return 0;
+	}
+
+	/*
+	 * Wait for the worker if its queue is full
+	 */
+	while (!OSCThreadedServer_push(&worker->queue, copy)) {
+		if (!__atomic_load_n(&threadedServer->running, __ATOMIC_ACQUIRE)) {
+			OSCMessage_delete(copy);
+			return 1;
+		}
+		sched_yield();
+	}
+
+	sem_post(&worker->pending);
+
+	return 1;
+}
+
+void* OSCThreadedServer_receive(void *arg) {
+	OSCThreadedServer *threadedServer = (OSCThreadedServer*)arg;
+
+	OSCPacketStream *stream = threadedServer->stream;
+
+	while (__atomic_load_n(&threadedServer->running, __ATOMIC_ACQUIRE)) {
+		OSCServer_cycle(threadedServer->server, stream);
+
+		/*
+		 * The wait is limited, so the stop request is noticed in time
+		 */
+		if (!OSCServer_wait(threadedServer->server, stream, OSC_THREADED_WAIT_LIMIT))
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+void* OSCThreadedServer_work(void *arg) {
+	OSCWorker *worker = (OSCWorker*)arg;
+
+	while (1) {
+		while (sem_wait(&worker->pending) != 0);	// retry if interrupted
+
+		OSCMessage *message = OSCThreadedServer_pop(&worker->queue);
+
+		if (message == NULL)
+			break;
+
+		OSCServer_callHandlers(worker->threadedServer->server, message, worker->pattern);
+
+		if (!OSCThreadedServer_push(&worker->returned, message))
+			OSCMessage_delete(message);
+	}
+
+	return NULL;
+}
+
+#endif /* OSC_THREADS */
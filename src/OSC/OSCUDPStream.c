@@ -0,0 +1,269 @@
+/**
+ * @file	OSCUDPStream.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		/* recvmmsg */
+#endif
+
+#include "OSC/OSCUDPStream.h"
+
+#ifdef __linux__
+
+#include "OSC/OSCAllocator.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+struct _OSCUDPStream {
+	OSCPacketStream stream;			/* Interface of the socket (its context points to this structure) */
+	int socket;
+	int timer;						/* timerfd which wakes up waitPacket when the timeout expires */
+	uint32_t packetSize;			/* Size of the pending datagram */
+	struct sockaddr_in destination;
+	uint8_t hasDestination;
+	struct sockaddr_in sender;		/* Sender of the last received datagram */
+	uint8_t hasSender;
+};
+
+/*
+ * Private functions
+ */
+
+uint32_t OSCUDPStream_getPacketSize(void *context);
+void OSCUDPStream_readPacket(void *context, uint8_t *buf);
+void OSCUDPStream_skipPacket(void *context);
+void OSCUDPStream_writePacket(void *context, uint8_t *buf, uint32_t size);
+void OSCUDPStream_waitPacket(void *context, uint32_t timeout);
+uint32_t OSCUDPStream_readPackets(void *context, OSCPacketSlot *slots, uint32_t count);
+
+
+OSCUDPStream* OSCUDPStream_open(uint16_t port) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)OSCAllocator_malloc(&OSCAllocator_default, sizeof(OSCUDPStream));
+
+	if (udpStream == NULL)
+		return NULL;
+
+	udpStream->stream.getPacketSize = OSCUDPStream_getPacketSize;
+	udpStream->stream.readPacket = OSCUDPStream_readPacket;
+	udpStream->stream.writePacket = OSCUDPStream_writePacket;
+	udpStream->stream.waitPacket = OSCUDPStream_waitPacket;
+	udpStream->stream.readPackets = OSCUDPStream_readPackets;
+	udpStream->stream.skipPacket = OSCUDPStream_skipPacket;
+	udpStream->stream.context = udpStream;
+
+	udpStream->socket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	udpStream->timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	udpStream->packetSize = 0;
+	udpStream->hasDestination = 0;
+	udpStream->hasSender = 0;
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	if (udpStream->socket < 0 || udpStream->timer < 0
+			|| bind(udpStream->socket, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		OSCUDPStream_close(udpStream);
+		return NULL;
+	}
+
+	return udpStream;
+}
+
+OSCPacketStream* OSCUDPStream_getStream(OSCUDPStream *udpStream) {
+	return &udpStream->stream;
+}
+
+int32_t OSCUDPStream_setDestination(OSCUDPStream *udpStream, const char *host, uint16_t port) {
+	memset(&udpStream->destination, 0, sizeof(udpStream->destination));
+	udpStream->destination.sin_family = AF_INET;
+	udpStream->destination.sin_port = htons(port);
+
+	udpStream->hasDestination = (inet_pton(AF_INET, host, &udpStream->destination.sin_addr) == 1);
+
+	return udpStream->hasDestination ? 0 : -1;
+}
+
+int32_t OSCUDPStream_getDescriptor(OSCUDPStream *udpStream) {
+	return udpStream->socket;
+}
+
+void OSCUDPStream_close(OSCUDPStream *udpStream) {
+	if (udpStream->socket >= 0)
+		close(udpStream->socket);
+	if (udpStream->timer >= 0)
+		close(udpStream->timer);
+
+	OSCAllocator_free(&OSCAllocator_default, udpStream);
+}
+
+uint32_t OSCUDPStream_getPacketSize(void *context) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)context;
+	while (1) {
+		/*
+		 * With MSG_TRUNC Linux returns the full size of the datagram
+		 */
+		ssize_t size = recv(udpStream->socket, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+
+		if (size > 0) {
+			udpStream->packetSize = size;
+			return size;
+		}
+
+		if (size < 0) {
+			if (errno == EINTR)
+				continue;
+			return 0;
+		}
+
+		recv(udpStream->socket, NULL, 0, MSG_DONTWAIT);	// drop the empty datagram
+	}
+}
+
+void OSCUDPStream_readPacket(void *context, uint8_t *buf) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)context;
+	socklen_t length = sizeof(udpStream->sender);
+
+	if (recvfrom(udpStream->socket, buf, udpStream->packetSize, 0, (struct sockaddr*)&udpStream->sender, &length) >= 0)
+		udpStream->hasSender = 1;
+}
+
+void OSCUDPStream_skipPacket(void *context) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)context;
+
+	recv(udpStream->socket, NULL, 0, MSG_DONTWAIT);	// the rest of the datagram is discarded
+}
+
+void OSCUDPStream_writePacket(void *context, uint8_t *buf, uint32_t size) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)context;
+	struct sockaddr_in *address;
+
+	if (udpStream->hasDestination)
+		address = &udpStream->destination;
+	else if (udpStream->hasSender)
+		address = &udpStream->sender;
+	else
+		return;
+
+	sendto(udpStream->socket, buf, size, 0, (struct sockaddr*)address, sizeof(*address));
+}
+
+void OSCUDPStream_waitPacket(void *context, uint32_t timeout) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)context;
+
+	if (timeout == 0)
+		return;
+
+	/*
+	 * Arm the timer (or disarm it if there is no timeout)
+	 */
+	struct itimerspec timer;
+	memset(&timer, 0, sizeof(timer));
+
+	if (timeout != OSC_WAIT_FOREVER) {
+		timer.it_value.tv_sec = timeout / 1000000;
+		timer.it_value.tv_nsec = (timeout % 1000000) * 1000;
+	}
+
+	timerfd_settime(udpStream->timer, 0, &timer, NULL);
+
+	struct pollfd descriptors[2];
+	descriptors[0].fd = udpStream->socket;
+	descriptors[0].events = POLLIN;
+	descriptors[1].fd = udpStream->timer;
+	descriptors[1].events = POLLIN;
+
+	if (poll(descriptors, 2, -1) > 0 && (descriptors[1].revents & POLLIN)) {
+		uint64_t expirations;
+		if (read(udpStream->timer, &expirations, sizeof(expirations)) < 0)
+			return;
+	}
+}
+
+/*
+ * Reads a batch of datagrams with a single recvmmsg call
+ */
+uint32_t OSCUDPStream_readPackets(void *context, OSCPacketSlot *slots, uint32_t count) {
+	OSCUDPStream *udpStream = (OSCUDPStream*)context;
+	struct mmsghdr messages[OSC_BATCH_SIZE];
+	struct iovec vectors[OSC_BATCH_SIZE];
+	struct sockaddr_in senders[OSC_BATCH_SIZE];
+
+	if (count > OSC_BATCH_SIZE)
+		count = OSC_BATCH_SIZE;
+
+	memset(messages, 0, sizeof(struct mmsghdr)*count);
+
+	uint32_t i;
+	for (i=0; i<count; i++) {
+		vectors[i].iov_base = slots[i].buf;
+		vectors[i].iov_len = slots[i].size;
+		messages[i].msg_hdr.msg_iov = &vectors[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+		messages[i].msg_hdr.msg_name = &senders[i];
+		messages[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+	}
+
+	int received;
+	do {
+		received = recvmmsg(udpStream->socket, messages, count, MSG_DONTWAIT | MSG_TRUNC, NULL);
+	} while (received < 0 && errno == EINTR);
+
+	if (received <= 0)
+		return 0;
+
+	for (i=0; i<(uint32_t)received; i++) {
+		/*
+		 * With MSG_TRUNC msg_len is the full size of the datagram
+		 */
+		if ((messages[i].msg_hdr.msg_flags & MSG_TRUNC) && messages[i].msg_len <= slots[i].size)
+			slots[i].size++;	// mark the packet which did not fit
+		else
+			slots[i].size = messages[i].msg_len;
+	}
+
+	udpStream->sender = senders[received-1];
+	udpStream->hasSender = 1;
+
+	return received;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,295 @@
+/**
+ * @file	OSCWriter.c
+ * @author  Giedrius Medzevicius <giedrius@8devices.com>
+ *
+ * @section LICENSE
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013 UAB 8devices
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ */
+
+#include "OSC/OSCWriter.h"
+
+#include <string.h>
+
+#include "OSC/OSCMisc.h"
+
+#define OSC_WRITER_NO_SIZE	0xffffffff	/* Size offset of a top level element (it has no size field) */
+
+/*
+ * Private functions
+ */
+
+OSCResult OSCWriter_fail(OSCWriter *writer, OSCResult result);
+uint8_t* OSCWriter_reserve(OSCWriter *writer, uint32_t size);
+void OSCWriter_put32(uint8_t *ptr, uint32_t value);
+OSCResult OSCWriter_appendPadded(OSCWriter *writer, const void *data, uint32_t size);
+OSCResult OSCWriter_beginElement(OSCWriter *writer);
+void OSCWriter_endElement(OSCWriter *writer);
+OSCResult OSCWriter_nextArgument(OSCWriter *writer, char type);
+
+
+void OSCWriter_init(OSCWriter *writer, uint8_t *buffer, uint32_t capacity) {
+	writer->buffer = buffer;
+	writer->capacity = capacity;
+	writer->size = 0;
+	writer->depth = 0;
+	writer->nextType = NULL;
+	writer->elementCount = 0;
+	writer->result = OSC_OK;
+}
+
+/*
+ * Remembers the first error
+ */
+OSCResult OSCWriter_fail(OSCWriter *writer, OSCResult result) {
+	if (writer->result == OSC_OK)
+		writer->result = result;
+
+	return writer->result;
+}
+
+/*
+ * Returns the position of the next size bytes and moves past them, NULL if they do not fit
+ */
+uint8_t* OSCWriter_reserve(OSCWriter *writer, uint32_t size) {
+	if (size > writer->capacity - writer->size) {
+		OSCWriter_fail(writer, OSC_BUFFER_TOO_SMALL);
+		return NULL;
+	}
+
+	uint8_t *ptr = writer->buffer + writer->size;
+	writer->size += size;
+
+	return ptr;
+}
+
+void OSCWriter_put32(uint8_t *ptr, uint32_t value) {
+	*ptr++ = (value >> 24);
+	*ptr++ = (value >> 16);
+	*ptr++ = (value >> 8);
+	*ptr++ = (value & 0xFF);
+}
+
+/*
+ * Copies the data and zeroes the padding after it
+ */
+OSCResult OSCWriter_appendPadded(OSCWriter *writer, const void *data, uint32_t size) {
+	uint32_t paddedSize = OSCMisc_getPaddedLength(size);
+	uint8_t *ptr = OSCWriter_reserve(writer, paddedSize);
+
+	if (ptr == NULL)
+		return writer->result;
+
+	if (size > 0)
+		memcpy(ptr, data, size);
+	memset(ptr + size, 0, paddedSize - size);
+
+	return OSC_OK;
+}
+
+/*
+ * Opens an element, elements inside a bundle get a size field which is filled in by
+ * OSCWriter_endElement
+ */
+OSCResult OSCWriter_beginElement(OSCWriter *writer) {
+	if (writer->result != OSC_OK)
+		return writer->result;
+
+	if (writer->nextType != NULL || writer->depth == OSC_WRITER_MAX_DEPTH
+			|| (writer->depth == 0 && writer->elementCount > 0))
+		return OSCWriter_fail(writer, OSC_ERROR);
+
+	uint32_t sizeOffset = OSC_WRITER_NO_SIZE;
+
+	if (writer->depth > 0) {
+		sizeOffset = writer->size;
+
+		if (OSCWriter_reserve(writer, 4) == NULL)
+			return writer->result;
+	} else {
+		writer->elementCount++;
+	}
+
+	writer->sizeOffsets[writer->depth++] = sizeOffset;
+
+	return OSC_OK;
+}
+
+void OSCWriter_endElement(OSCWriter *writer) {
+	uint32_t sizeOffset = writer->sizeOffsets[--writer->depth];
+
+	if (sizeOffset != OSC_WRITER_NO_SIZE)
+		OSCWriter_put32(writer->buffer + sizeOffset, writer->size - sizeOffset - 4);
+}
+
+OSCResult OSCWriter_beginBundle(OSCWriter *writer, uint64_t timetag) {
+	if (OSCWriter_beginElement(writer) != OSC_OK)
+		return writer->result;
+
+	uint8_t *ptr = OSCWriter_reserve(writer, 8 + 8);
+
+	if (ptr == NULL)
+		return writer->result;
+
+	memcpy(ptr, "#bundle", 8);	// including null
+	OSCWriter_put32(ptr + 8, timetag >> 32);
+	OSCWriter_put32(ptr + 12, timetag & 0xFFFFFFFF);
+
+	return OSC_OK;
+}
+
+OSCResult OSCWriter_endBundle(OSCWriter *writer) {
+	if (writer->result != OSC_OK)
+		return writer->result;
+
+	if (writer->nextType != NULL || writer->depth == 0)
+		return OSCWriter_fail(writer, OSC_ERROR);
+
+	OSCWriter_endElement(writer);
+
+	return OSC_OK;
+}
+
+OSCResult OSCWriter_beginMessage(OSCWriter *writer, const char *address, const char *types) {
+	if (OSCWriter_beginElement(writer) != OSC_OK)
+		return writer->result;
+
+	if (OSCWriter_appendPadded(writer, address, strlen(address) + 1) != OSC_OK)	// including null
+		return writer->result;
+
+	uint32_t typesLength = strlen(types);
+	uint32_t typesSize = OSCMisc_getPaddedLength(typesLength + 2);	// including , and null
+	uint8_t *ptr = OSCWriter_reserve(writer, typesSize);
+
+	if (ptr == NULL)
+		return writer->result;
+
+	*ptr = ',';
+	memcpy(ptr + 1, types, typesLength);
+	memset(ptr + 1 + typesLength, 0, typesSize - typesLength - 1);
+
+	writer->nextType = (char*)(ptr + 1);
+
+	return OSC_OK;
+}
+
+/*
+ * Checks that the type is the next one of the open message
+ */
+OSCResult OSCWriter_nextArgument(OSCWriter *writer, char type) {
+	if (writer->result != OSC_OK)
+		return writer->result;
+
+	if (writer->nextType == NULL)
+		return OSCWriter_fail(writer, OSC_ERROR);
+
+	if (*writer->nextType != type)
+		return OSCWriter_fail(writer, OSC_FORMAT_ERROR);
+
+	writer->nextType++;
+
+	return OSC_OK;
+}
+
+OSCResult OSCWriter_append_int32(OSCWriter *writer, int32_t i) {
+	if (OSCWriter_nextArgument(writer, 'i') != OSC_OK)
+		return writer->result;
+
+	uint8_t *ptr = OSCWriter_reserve(writer, 4);
+
+	if (ptr == NULL)
+		return writer->result;
+
+	OSCWriter_put32(ptr, i);
+
+	return OSC_OK;
+}
+
+OSCResult OSCWriter_append_float(OSCWriter *writer, float f) {
+	if (OSCWriter_nextArgument(writer, 'f') != OSC_OK)
+		return writer->result;
+
+	uint8_t *ptr = OSCWriter_reserve(writer, 4);
+
+	if (ptr == NULL)
+		return writer->result;
+
+	union { float f; uint32_t i; } tmp;
+	tmp.f = f;
+	OSCWriter_put32(ptr, tmp.i);
+
+	return OSC_OK;
+}
+
+OSCResult OSCWriter_append_string(OSCWriter *writer, const char *s) {
+	if (OSCWriter_nextArgument(writer, 's') != OSC_OK)
+		return writer->result;
+
+	return OSCWriter_appendPadded(writer, s, strlen(s) + 1);	// including null
+}
+
+OSCResult OSCWriter_append_blob(OSCWriter *writer, const uint8_t *blob, uint32_t size) {
+	if (OSCWriter_nextArgument(writer, 'b') != OSC_OK)
+		return writer->result;
+
+	uint8_t *ptr = OSCWriter_reserve(writer, 4);
+
+	if (ptr == NULL)
+		return writer->result;
+
+	OSCWriter_put32(ptr, size);
+
+	return OSCWriter_appendPadded(writer, blob, size);
+}
+
+OSCResult OSCWriter_endMessage(OSCWriter *writer) {
+	if (writer->result != OSC_OK)
+		return writer->result;
+
+	if (writer->nextType == NULL)
+		return OSCWriter_fail(writer, OSC_ERROR);
+
+	if (*writer->nextType != '\0')	// some arguments are missing
+		return OSCWriter_fail(writer, OSC_FORMAT_ERROR);
+
+	writer->nextType = NULL;
+	OSCWriter_endElement(writer);
+
+	return OSC_OK;
+}
+
+OSCResult OSCWriter_finish(OSCWriter *writer, uint32_t *size) {
+	if (size != NULL)
+		*size = writer->size;
+
+	if (writer->result != OSC_OK)
+		return writer->result;
+
+	if (writer->depth > 0 || writer->elementCount == 0)
+		return OSC_ERROR;
+
+	return OSC_OK;
+}